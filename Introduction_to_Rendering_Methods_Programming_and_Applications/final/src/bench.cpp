@@ -0,0 +1,619 @@
+#include "engine/kernels.hpp"
+#include "engine/physics.hpp"
+#include "engine/trajectory.hpp"
+#include "scene/scene.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// physics benchmarks, nothing here is needed by the simulation itself
+
+// every operator new of the process is counted, see narrowPhaseBenchmark; the
+// aligned body arrays come from posix_memalign and are sized once per scene
+static std::atomic<unsigned long> allocations{0};
+
+static void *allocate(std::size_t size)
+{
+    allocations++;
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+#if defined(__cpp_aligned_new) && !defined(_MSC_VER)
+static void *allocate(std::size_t size, std::align_val_t alignment)
+{
+    allocations++;
+    void *p = nullptr;
+    std::size_t bytes = std::max<std::size_t>((std::size_t)alignment, sizeof(void *));
+    if (posix_memalign(&p, bytes, size ? size : 1) == 0) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+void *operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#endif
+
+void usage(const char *program)
+{
+    std::cerr << "Expect: " << program << " [benchmark] [options]\n"
+              << "  energy [scene file]   relative energy drift per integrator and tick\n"
+              << "    --time S        simulated time in s (10)\n"
+              << "    --ticks LIST    comma separated ticks in ms (1,2,5,10,20)\n"
+              << "  narrowphase [scene file]   time and heap allocations of the pair tests\n"
+              << "    --rounds N      tests of every pair (100)\n"
+              << "  gravity [scene file]   force error against the exact sum and time per gravity mode\n"
+              << "    --ticks N       ticks timed per mode (100)\n"
+              << "    --sources R     attractors source mass ratio (0.001)\n"
+              << "  trajectory [scene file]   recording cost and random frame access of a replay\n"
+              << "    --ticks N       ticks recorded (1000)\n"
+              << "    --output FILE   recording (trajectory.trj)\n"
+              << "  checkpoint [scene file]   save and restore time against loading the scene\n"
+              << "    --ticks N       ticks before the checkpoint (1000)\n"
+              << "    --after N       ticks run from the original and the restored state (1000)\n"
+              << "    --output FILE   checkpoint (checkpoint.ckpt)\n"
+              << "  kernels   every SIMD kernel the CPU supports against the scalar one\n"
+              << "    --bodies N      length of the arrays (4099)\n"
+              << "    --rounds N      rows timed per kernel (200)\n"
+              << std::endl;
+}
+
+std::vector<unsigned int> parseList(const std::string &list)
+{
+    std::vector<unsigned int> values;
+    std::stringstream in(list);
+    std::string value;
+    while (std::getline(in, value, ','))
+    {
+        values.push_back((unsigned int)std::stoul(value));
+    }
+    return values;
+}
+
+// kinetic + mg height + pairwise gravity, contact springs are left out so
+// scenes without resting contacts (orbits) give meaningful numbers
+double energy(Scene::Scene &scene)
+{
+    auto &bodies = scene.bodies();
+    double G = scene.context().G, g = scene.context().g;
+    double E = 0;
+    for (std::size_t i=0; i<bodies.size(); i++)
+    {
+        // summed in double, the drift is far below float resolution
+        auto &s = bodies[i]->state();
+        double mass = (double)s.mass;
+        glm::dvec3 velocity(s.velocity), centroid(s.centroid);
+        E += 0.5 * mass * glm::dot(velocity, velocity);
+        if (s.movable) E += mass * g * centroid.z;
+        for (std::size_t j=i+1; j<bodies.size(); j++)
+        {
+            auto &t = bodies[j]->state();
+            double r = glm::length(glm::dvec3(t.centroid) - centroid);
+            E -= G * mass * (double)t.mass / r;
+        }
+    }
+    return E;
+}
+
+int energyBenchmark(int argc, char *argv[])
+{
+    if (argc <= 2)
+    {
+        std::cerr << "Not enough parameter\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string sceneFile{argv[2]};
+    double time{10};
+    std::vector<unsigned int> ticks{1, 2, 5, 10, 20};
+    for (int i=3; i+1<argc; i+=2)
+    {
+        std::string option{argv[i]}, value{argv[i + 1]};
+        if (option == "--time") time = std::stod(value);
+        else if (option == "--ticks") ticks = parseList(value);
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n";
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const char *names[] = {"euler", "verlet", "rk4"};
+    const Engine::PhysicsModule::Integrator integrators[] = {
+        Engine::PhysicsModule::Integrator::SemiImplicitEuler,
+        Engine::PhysicsModule::Integrator::Verlet,
+        Engine::PhysicsModule::Integrator::RK4};
+
+    Engine::PhysicsModule::Context context;
+    context.threadNum = 1;
+    context.gravity = Engine::PhysicsModule::Gravity::Exact;
+    context.sleep = false;
+
+    std::cout << "integrator,tick_ms,steps,max_drift,final_drift\n";
+    for (int k=0; k<3; k++)
+    {
+        for (auto tick : ticks)
+        {
+            auto scene = std::make_shared<Scene::Scene>(sceneFile);
+            auto physics = std::make_shared<Engine::PhysicsModule>(tick, context);
+            physics->init();
+            physics->setScene(scene);
+            physics->setIntegrator(integrators[k]);
+
+            double E0 = energy(*scene), drift = 0, maxDrift = 0;
+            unsigned long steps = (unsigned long)std::llround(time * 1000.0 / tick);
+            for (unsigned long s=0; s<steps; s++)
+            {
+                physics->advance(1);
+                drift = std::abs(energy(*scene) - E0) / std::max(std::abs(E0), 1e-30);
+                maxDrift = std::max(maxDrift, drift);
+            }
+            physics->finish();
+
+            std::cout << names[k] << "," << tick << "," << steps << ","
+                      << maxDrift << "," << drift << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int narrowPhaseBenchmark(int argc, char *argv[])
+{
+    if (argc <= 2)
+    {
+        std::cerr << "Not enough parameter\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string sceneFile{argv[2]};
+    unsigned int rounds{100};
+    for (int i=3; i+1<argc; i+=2)
+    {
+        std::string option{argv[i]}, value{argv[i + 1]};
+        if (option == "--rounds") rounds = (unsigned int)std::stoul(value);
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n";
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Engine::PhysicsModule::Context context;
+    context.threadNum = 1;
+    auto scene = std::make_shared<Scene::Scene>(sceneFile);
+    auto physics = std::make_shared<Engine::PhysicsModule>(1, context);
+    physics->init();
+    physics->setScene(scene);
+
+    // every pair, not only what a broad phase would let through; one round
+    // first so caches that grow once (separating axes) are not counted
+    int n = (int)scene->bodies().size();
+    Engine::ContactStore::Contact contact{};
+    unsigned long contacts = 0;
+    for (int i=0; i<n; i++)
+        for (int j=i+1; j<n; j++)
+            physics->testPair(i, j, contact);
+
+    unsigned long before = allocations;
+    auto t1 = std::chrono::steady_clock::now();
+    for (unsigned int round=0; round<rounds; round++)
+        for (int i=0; i<n; i++)
+            for (int j=i+1; j<n; j++)
+                contacts += physics->testPair(i, j, contact) ? 1 : 0;
+    auto t2 = std::chrono::steady_clock::now();
+    unsigned long allocated = allocations - before;
+    physics->finish();
+
+    double calls = (double)rounds * n * (n - 1) / 2;
+    std::chrono::duration<double, std::nano> elapsed = t2 - t1;
+    std::cout << "pairs,calls,contacts,ns_per_call,allocations,allocations_per_call\n"
+              << (unsigned long)n * (n - 1) / 2 << "," << (unsigned long)calls << "," << contacts << ","
+              << elapsed.count() / std::max(calls, 1.0) << "," << allocated << ","
+              << (double)allocated / std::max(calls, 1.0) << std::endl;
+    return allocated == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// errors are taken at the start and again after the timed ticks, each mode
+// from its own trajectory
+int gravityBenchmark(int argc, char *argv[])
+{
+    if (argc <= 2)
+    {
+        std::cerr << "Not enough parameter\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string sceneFile{argv[2]};
+    unsigned int ticks{100};
+    Engine::PhysicsModule::Context context;
+    context.threadNum = 1;
+    context.sleep = false;
+    for (int i=3; i+1<argc; i+=2)
+    {
+        std::string option{argv[i]}, value{argv[i + 1]};
+        if (option == "--ticks") ticks = (unsigned int)std::stoul(value);
+        else if (option == "--sources") context.sourceRatio = std::stof(value);
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n";
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const char *names[] = {"exact", "barneshut", "attractors"};
+    const Engine::PhysicsModule::Gravity modes[] = {
+        Engine::PhysicsModule::Gravity::Exact,
+        Engine::PhysicsModule::Gravity::BarnesHut,
+        Engine::PhysicsModule::Gravity::Attractors};
+
+    std::cout << "gravity,sources,max_error,mean_error,final_max_error,final_mean_error,ms_per_tick\n";
+    for (int k=0; k<3; k++)
+    {
+        context.gravity = modes[k];
+        auto scene = std::make_shared<Scene::Scene>(sceneFile);
+        auto physics = std::make_shared<Engine::PhysicsModule>(1, context);
+        physics->init();
+        physics->setScene(scene);
+
+        auto start = physics->gravityReport();
+        auto t1 = std::chrono::steady_clock::now();
+        physics->advance(ticks);
+        auto t2 = std::chrono::steady_clock::now();
+        auto end = physics->gravityReport();
+        physics->finish();
+
+        std::chrono::duration<double, std::milli> elapsed = t2 - t1;
+        std::cout << names[k] << "," << start.sources << "," << start.maxError << "," << start.meanError << ","
+                  << end.maxError << "," << end.meanError << "," << elapsed.count() / std::max(ticks, 1u)
+                  << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+// the same ticks with and without recording, then frames of the file read
+// in random order; fails if the frames don't hold the ticks in order or the
+// last one differs from the final state
+int trajectoryBenchmark(int argc, char *argv[])
+{
+    if (argc <= 2)
+    {
+        std::cerr << "Not enough parameter\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string sceneFile{argv[2]};
+    unsigned int ticks{1000};
+    std::string path{"trajectory.trj"};
+    for (int i=3; i+1<argc; i+=2)
+    {
+        std::string option{argv[i]}, value{argv[i + 1]};
+        if (option == "--ticks") ticks = (unsigned int)std::stoul(value);
+        else if (option == "--output") path = value;
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n";
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Engine::PhysicsModule::Context context;
+    context.threadNum = 1;
+    double times[2];
+    std::shared_ptr<Scene::Scene> scene;
+    for (int k=0; k<2; k++)
+    {
+        if (k == 1) context.recordFile = path;
+        scene = std::make_shared<Scene::Scene>(sceneFile);
+        auto physics = std::make_shared<Engine::PhysicsModule>(1, context);
+        physics->init();
+        physics->setScene(scene);
+        auto t1 = std::chrono::steady_clock::now();
+        physics->advance(ticks);
+        auto t2 = std::chrono::steady_clock::now();
+        physics->finish();
+        times[k] = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    Engine::TrajectoryReader reader;
+    if (!reader.open(path)) return EXIT_FAILURE;
+    auto t2 = std::chrono::steady_clock::now();
+
+    // tick 0 is the state setScene() published
+    unsigned long mismatches = reader.frames() == ticks + 1 ? 0 : 1;
+    for (std::size_t f=0; f<reader.frames(); f++)
+    {
+        mismatches += reader.tick(f) != f;
+    }
+    // the bodies got there by adding up displacements, so not to the bit
+    auto &bodies = scene->bodies();
+    for (std::size_t i=0; i<bodies.size() && reader.frames() > 0; i++)
+    {
+        const Engine::Pose &pose = reader.poses(reader.frames() - 1)[i];
+        glm::vec3 position(pose.position[0], pose.position[1], pose.position[2]);
+        glm::vec3 centroid = bodies[i]->state().centroid;
+        mismatches += glm::length(position - centroid) > 1e-5f * (1 + glm::length(centroid));
+    }
+
+    std::mt19937 random(5);
+    std::uniform_int_distribution<std::size_t> pick(0, reader.frames() > 0 ? reader.frames() - 1 : 0);
+    const std::size_t reads = 10000;
+    GLfloat sum = 0;
+    auto t3 = std::chrono::steady_clock::now();
+    for (std::size_t r=0; r<reads && reader.frames() > 0; r++)
+    {
+        std::size_t frame = pick(random);
+        for (int i=0; i<reader.bodies(); i++)
+        {
+            sum += reader.model(frame, i)[3][0];
+        }
+    }
+    auto t4 = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double, std::milli> open = t2 - t1;
+    std::chrono::duration<double, std::nano> read = t4 - t3;
+    std::cout << "ticks,bodies,frames,bytes,plain_ms,recorded_ms,us_per_tick_recording,open_ms,"
+                 "ns_per_random_frame,mismatches,checksum\n"
+              << ticks << "," << reader.bodies() << "," << reader.frames() << ","
+              << (unsigned long)(reader.frames() * (8 + reader.bodies() * sizeof(Engine::Pose))) << ","
+              << times[0] << "," << times[1] << "," << (times[1] - times[0]) * 1000 / std::max(ticks, 1u) << ","
+              << open.count() << "," << read.count() / reads << "," << mismatches << "," << sum << std::endl;
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// restart cost: loading the scene against saving and restoring a state of
+// it; fails unless the restored run goes on exactly like the original one,
+// to the bit, single threaded so that both take the same steps
+int checkpointBenchmark(int argc, char *argv[])
+{
+    if (argc <= 2)
+    {
+        std::cerr << "Not enough parameter\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string sceneFile{argv[2]};
+    unsigned int ticks{1000};
+    unsigned int after{1000};
+    std::string path{"checkpoint.ckpt"};
+    for (int i=3; i+1<argc; i+=2)
+    {
+        std::string option{argv[i]}, value{argv[i + 1]};
+        if (option == "--ticks") ticks = (unsigned int)std::stoul(value);
+        else if (option == "--after") after = (unsigned int)std::stoul(value);
+        else if (option == "--output") path = value;
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n";
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Engine::PhysicsModule::Context context;
+    context.threadNum = 1;
+    auto original = std::make_shared<Engine::PhysicsModule>(1, context);
+    original->init();
+    auto t1 = std::chrono::steady_clock::now();
+    original->setScene(std::make_shared<Scene::Scene>(sceneFile));
+    auto t2 = std::chrono::steady_clock::now();
+    original->advance(ticks);
+
+    auto t3 = std::chrono::steady_clock::now();
+    bool saved = original->saveCheckpoint(path);
+    auto t4 = std::chrono::steady_clock::now();
+    auto restored = std::make_shared<Engine::PhysicsModule>(1, context);
+    restored->init();
+    bool loaded = saved && restored->restoreCheckpoint(path);
+    auto t5 = std::chrono::steady_clock::now();
+    if (!loaded) return EXIT_FAILURE;
+
+    original->advance(after);
+    restored->advance(after);
+    unsigned long mismatches = original->ticks() != restored->ticks();
+    auto &bodies = original->scene()->bodies();
+    auto &copies = restored->scene()->bodies();
+    mismatches += bodies.size() != copies.size();
+    for (std::size_t i=0; i<bodies.size() && i<copies.size(); i++)
+    {
+        auto &a = bodies[i]->state();
+        auto &b = copies[i]->state();
+        mismatches += std::memcmp(&a.centroid, &b.centroid, sizeof(a.centroid)) != 0 ||
+                      std::memcmp(&a.velocity, &b.velocity, sizeof(a.velocity)) != 0;
+    }
+    original->finish();
+    restored->finish();
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    std::chrono::duration<double, std::milli> load = t2 - t1, save = t4 - t3, restore = t5 - t4;
+    std::cout << "bodies,ticks,after,bytes,load_ms,save_ms,restore_ms,mismatches\n"
+              << bodies.size() << "," << ticks << "," << after << "," << (long long)file.tellg() << ","
+              << load.count() << "," << save.count() << "," << restore.count() << "," << mismatches << std::endl;
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// fails if a SIMD kernel disagrees with the scalar one: gravity beyond
+// float rounding or any difference in the overlap hits
+int kernelsBenchmark(int argc, char *argv[])
+{
+    int n{4099}; // not a multiple of the lane count, so the tails run too
+    unsigned int rounds{200};
+    for (int i=2; i+1<argc; i+=2)
+    {
+        std::string option{argv[i]}, value{argv[i + 1]};
+        if (option == "--bodies") n = std::max(1, std::stoi(value));
+        else if (option == "--rounds") rounds = (unsigned int)std::stoul(value);
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n";
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<GLfloat> position(-10, 10), size(0.05f, 0.5f);
+    Engine::AlignedVector<GLfloat> px(n), py(n), pz(n), mass(n), bound(n);
+    for (int i=0; i<n; i++)
+    {
+        px[i] = position(random);
+        py[i] = position(random);
+        pz[i] = position(random);
+        mass[i] = size(random) * 10;
+        bound[i] = size(random);
+    }
+
+    const GLfloat G = 6.674e-11f, eps = 1e-9f;
+    std::vector<int> rows;
+    for (int s=0; s<n; s+=std::max(1, n / 64)) rows.push_back(s);
+
+    // reference results of every row
+    auto scalar = Engine::Kernels::select(Engine::Kernels::Isa::Scalar);
+    std::vector<std::vector<GLfloat>> referenceForce(rows.size());
+    std::vector<glm::vec3> referenceSum(rows.size());
+    std::vector<std::vector<int>> referenceHits(rows.size());
+    std::vector<GLfloat> fx(n), fy(n), fz(n);
+    std::vector<int> hits(n);
+    for (std::size_t k=0; k<rows.size(); k++)
+    {
+        int s = rows[k];
+        glm::vec3 p(px[s], py[s], pz[s]);
+        std::fill(fx.begin(), fx.end(), 0.0f);
+        std::fill(fy.begin(), fy.end(), 0.0f);
+        std::fill(fz.begin(), fz.end(), 0.0f);
+        referenceSum[k] = glm::vec3(0);
+        scalar.gravityRow(px.data(), py.data(), pz.data(), mass.data(), s + 1, n, p, G * mass[s], eps,
+                          fx.data(), fy.data(), fz.data(), referenceSum[k]);
+        referenceForce[k] = fx;
+        referenceForce[k].insert(referenceForce[k].end(), fy.begin(), fy.end());
+        referenceForce[k].insert(referenceForce[k].end(), fz.begin(), fz.end());
+        int count = scalar.sphereOverlap(px.data(), py.data(), pz.data(), bound.data(), s + 1, n,
+                                         p, bound[s], hits.data());
+        referenceHits[k].assign(hits.begin(), hits.begin() + count);
+    }
+
+    const Engine::Kernels::Isa isas[] = {
+        Engine::Kernels::Isa::Scalar, Engine::Kernels::Isa::SSE,
+        Engine::Kernels::Isa::AVX2, Engine::Kernels::Isa::NEON};
+
+    bool agree = true;
+    std::cout << "kernels,max_gravity_error,overlap_mismatches,gravity_ns_per_pair,overlap_ns_per_pair\n";
+    for (auto isa : isas)
+    {
+        if (!Engine::Kernels::supported(isa)) continue;
+        auto kernels = Engine::Kernels::select(isa);
+
+        // error relative to the largest force of the row, single forces
+        // can be nearly cancelled and say nothing about the kernel
+        double maxError = 0;
+        unsigned long mismatches = 0;
+        for (std::size_t k=0; k<rows.size(); k++)
+        {
+            int s = rows[k];
+            glm::vec3 p(px[s], py[s], pz[s]);
+            std::fill(fx.begin(), fx.end(), 0.0f);
+            std::fill(fy.begin(), fy.end(), 0.0f);
+            std::fill(fz.begin(), fz.end(), 0.0f);
+            glm::vec3 sum(0);
+            kernels.gravityRow(px.data(), py.data(), pz.data(), mass.data(), s + 1, n, p, G * mass[s], eps,
+                               fx.data(), fy.data(), fz.data(), sum);
+
+            const auto &reference = referenceForce[k];
+            double scale = glm::length(referenceSum[k]);
+            for (auto f : reference) scale = std::max(scale, (double)std::abs(f));
+            scale = std::max(scale, 1e-30);
+            double error = glm::length(sum - referenceSum[k]);
+            for (int t=0; t<n; t++)
+            {
+                error = std::max(error, (double)std::abs(fx[t] - reference[t]));
+                error = std::max(error, (double)std::abs(fy[t] - reference[n + t]));
+                error = std::max(error, (double)std::abs(fz[t] - reference[2 * n + t]));
+            }
+            maxError = std::max(maxError, error / scale);
+
+            int count = kernels.sphereOverlap(px.data(), py.data(), pz.data(), bound.data(), s + 1, n,
+                                              p, bound[s], hits.data());
+            if (std::vector<int>(hits.begin(), hits.begin() + count) != referenceHits[k]) mismatches++;
+        }
+        if (maxError > 1e-4 || mismatches) agree = false;
+
+        // full rows from body 0, the longest the physics runs
+        glm::vec3 p(px[0], py[0], pz[0]), sum(0);
+        auto t1 = std::chrono::steady_clock::now();
+        for (unsigned int round=0; round<rounds; round++)
+        {
+            kernels.gravityRow(px.data(), py.data(), pz.data(), mass.data(), 1, n, p, G * mass[0], eps,
+                               fx.data(), fy.data(), fz.data(), sum);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        for (unsigned int round=0; round<rounds; round++)
+        {
+            kernels.sphereOverlap(px.data(), py.data(), pz.data(), bound.data(), 1, n,
+                                           p, bound[0], hits.data());
+        }
+        auto t3 = std::chrono::steady_clock::now();
+
+        double pairs = (double)rounds * std::max(n - 1, 1);
+        std::chrono::duration<double, std::nano> gravityTime = t2 - t1, overlapTime = t3 - t2;
+        std::cout << Engine::Kernels::name(isa) << "," << maxError << "," << mismatches << ","
+                  << gravityTime.count() / pairs << "," << overlapTime.count() / pairs << std::endl;
+    }
+
+    std::cout << "auto: " << Engine::Kernels::name(Engine::Kernels::select(Engine::Kernels::Isa::Auto).isa)
+              << std::endl;
+    if (!agree) std::cerr << "SIMD kernels disagree with the scalar ones\n";
+    return agree ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc <= 1)
+    {
+        std::cerr << "Not enough parameter\n";
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    std::string benchmark{argv[1]};
+    if (benchmark == "energy") return energyBenchmark(argc, argv);
+    if (benchmark == "narrowphase") return narrowPhaseBenchmark(argc, argv);
+    if (benchmark == "gravity") return gravityBenchmark(argc, argv);
+    if (benchmark == "trajectory") return trajectoryBenchmark(argc, argv);
+    if (benchmark == "checkpoint") return checkpointBenchmark(argc, argv);
+    if (benchmark == "kernels") return kernelsBenchmark(argc, argv);
+
+    std::cerr << "Unknown benchmark: " << benchmark << "\n";
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,266 @@
+#include "engine/aabb_tree.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace Engine
+{
+
+DynamicAabbTree::DynamicAabbTree()
+    : root_{-1}, free_{-1}, margin_{0}
+{}
+
+void DynamicAabbTree::clear()
+{
+    nodes_.clear();
+    root_ = -1;
+    free_ = -1;
+}
+
+void DynamicAabbTree::setMargin(GLfloat margin) { margin_ = margin; }
+
+int DynamicAabbTree::insert(const Aabb &box, int body)
+{
+    int leaf = allocateNode();
+    nodes_[leaf].box = fatten(box, glm::vec3(0));
+    nodes_[leaf].body = body;
+    insertLeaf(leaf);
+    return leaf;
+}
+
+void DynamicAabbTree::remove(int proxy)
+{
+    removeLeaf(proxy);
+    freeNode(proxy);
+}
+
+bool DynamicAabbTree::move(int proxy, const Aabb &box, const glm::vec3 &displacement)
+{
+    if (contains(nodes_[proxy].box, box)) return false;
+
+    removeLeaf(proxy);
+    nodes_[proxy].box = fatten(box, displacement);
+    insertLeaf(proxy);
+    return true;
+}
+
+const Aabb& DynamicAabbTree::fatBox(int proxy) const { return nodes_[proxy].box; }
+
+int DynamicAabbTree::height() const { return root_ < 0 ? 0 : nodes_[root_].height; }
+
+int DynamicAabbTree::allocateNode()
+{
+    int node = free_;
+    if (node >= 0)
+    {
+        free_ = nodes_[node].parent;
+    }
+    else
+    {
+        node = (int)nodes_.size();
+        nodes_.push_back(Node{});
+    }
+    nodes_[node].parent = -1;
+    nodes_[node].child1 = nodes_[node].child2 = -1;
+    nodes_[node].height = 0;
+    nodes_[node].body = -1;
+    return node;
+}
+
+void DynamicAabbTree::freeNode(int node)
+{
+    nodes_[node].parent = free_;
+    nodes_[node].height = -1;
+    free_ = node;
+}
+
+void DynamicAabbTree::insertLeaf(int leaf)
+{
+    if (root_ < 0)
+    {
+        root_ = leaf;
+        nodes_[leaf].parent = -1;
+        return;
+    }
+
+    // descend while pushing the leaf further down is cheaper than making it
+    // the sibling here; every ancestor grows by the leaf either way
+    const Aabb box = nodes_[leaf].box;
+    int index = root_;
+    while (!nodes_[index].leaf())
+    {
+        const Node &node = nodes_[index];
+        GLfloat combined = area(merge(node.box, box));
+        GLfloat cost = 2 * combined;                       // new parent of node and leaf
+        GLfloat inheritance = 2 * (combined - area(node.box)); // growth of node below
+
+        GLfloat childCost[2];
+        int children[2] = {node.child1, node.child2};
+        for (int k=0; k<2; k++)
+        {
+            const Node &child = nodes_[children[k]];
+            GLfloat grown = area(merge(child.box, box));
+            childCost[k] = (child.leaf() ? grown : grown - area(child.box)) + inheritance;
+        }
+
+        if (cost < childCost[0] && cost < childCost[1]) break;
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+
+    // new parent of the sibling and the leaf
+    int sibling = index;
+    int oldParent = nodes_[sibling].parent;
+    int parent = allocateNode();
+    nodes_[parent].parent = oldParent;
+    nodes_[parent].box = merge(box, nodes_[sibling].box);
+    nodes_[parent].height = nodes_[sibling].height + 1;
+    nodes_[parent].child1 = sibling;
+    nodes_[parent].child2 = leaf;
+    nodes_[sibling].parent = parent;
+    nodes_[leaf].parent = parent;
+    if (oldParent < 0)
+    {
+        root_ = parent;
+    }
+    else if (nodes_[oldParent].child1 == sibling)
+    {
+        nodes_[oldParent].child1 = parent;
+    }
+    else
+    {
+        nodes_[oldParent].child2 = parent;
+    }
+
+    refit(nodes_[leaf].parent);
+}
+
+void DynamicAabbTree::removeLeaf(int leaf)
+{
+    if (leaf == root_)
+    {
+        root_ = -1;
+        return;
+    }
+
+    // the sibling takes the place of the parent
+    int parent = nodes_[leaf].parent;
+    int grandParent = nodes_[parent].parent;
+    int sibling = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+    if (grandParent < 0)
+    {
+        root_ = sibling;
+        nodes_[sibling].parent = -1;
+    }
+    else
+    {
+        if (nodes_[grandParent].child1 == parent) nodes_[grandParent].child1 = sibling;
+        else nodes_[grandParent].child2 = sibling;
+        nodes_[sibling].parent = grandParent;
+        refit(grandParent);
+    }
+    freeNode(parent);
+    nodes_[leaf].parent = -1;
+}
+
+void DynamicAabbTree::refit(int node)
+{
+    while (node >= 0)
+    {
+        node = balance(node);
+        Node &n = nodes_[node];
+        n.box = merge(nodes_[n.child1].box, nodes_[n.child2].box);
+        n.height = 1 + std::max(nodes_[n.child1].height, nodes_[n.child2].height);
+        node = n.parent;
+    }
+}
+
+int DynamicAabbTree::balance(int a)
+{
+    // a rotation when one child of a is more than one level taller than the
+    // other: its taller grandchild stays, the other one swaps places with a's
+    // short child. Returns the node now in a's place
+    Node &A = nodes_[a];
+    if (A.leaf() || A.height < 2) return a;
+
+    int b = A.child1, c = A.child2;
+    int balance = nodes_[c].height - nodes_[b].height;
+    if (balance >= -1 && balance <= 1) return a;
+
+    // tall is lifted into a's place, a becomes its child
+    int tall = balance > 0 ? c : b;
+    int shortChild = balance > 0 ? b : c;
+    Node &T = nodes_[tall];
+    int f = T.child1, g = T.child2;
+
+    T.child1 = a;
+    T.parent = A.parent;
+    A.parent = tall;
+    if (T.parent < 0)
+    {
+        root_ = tall;
+    }
+    else if (nodes_[T.parent].child1 == a)
+    {
+        nodes_[T.parent].child1 = tall;
+    }
+    else
+    {
+        nodes_[T.parent].child2 = tall;
+    }
+
+    // the taller grandchild stays under tall, the other goes to a
+    int keep = nodes_[f].height > nodes_[g].height ? f : g;
+    int give = keep == f ? g : f;
+    T.child2 = keep;
+    A.child1 = shortChild;
+    A.child2 = give;
+    nodes_[give].parent = a;
+
+    A.box = merge(nodes_[shortChild].box, nodes_[give].box);
+    A.height = 1 + std::max(nodes_[shortChild].height, nodes_[give].height);
+    T.box = merge(A.box, nodes_[keep].box);
+    T.height = 1 + std::max(A.height, nodes_[keep].height);
+    return tall;
+}
+
+Aabb DynamicAabbTree::fatten(const Aabb &box, const glm::vec3 &displacement) const
+{
+    return Aabb{box.min - margin_ + glm::min(displacement, glm::vec3(0)),
+                box.max + margin_ + glm::max(displacement, glm::vec3(0))};
+}
+
+Aabb DynamicAabbTree::merge(const Aabb &a, const Aabb &b)
+{
+    return Aabb{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+GLfloat DynamicAabbTree::area(const Aabb &box)
+{
+    glm::vec3 d = box.max - box.min;
+    return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool DynamicAabbTree::contains(const Aabb &outer, const Aabb &inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+bool DynamicAabbTree::hit(const Aabb &box, const glm::vec3 &origin, const glm::vec3 &inverse,
+                          GLfloat maxDistance, GLfloat &distance)
+{
+    // slab test; a ray in a slab plane gives nan, the argument order below
+    // makes min and max ignore it
+    GLfloat enter = 0, exit = maxDistance;
+    for (int k=0; k<3; k++)
+    {
+        GLfloat t1 = (box.min[k] - origin[k]) * inverse[k];
+        GLfloat t2 = (box.max[k] - origin[k]) * inverse[k];
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+    }
+    distance = enter;
+    return enter <= exit;
+}
+
+} // namespace Engine
@@ -0,0 +1,138 @@
+#ifndef ENGINE_AABB_TREE_HPP
+#define ENGINE_AABB_TREE_HPP
+
+#include "engine/broadphase.hpp"
+
+#include <vector>
+
+namespace Engine
+{
+
+// dynamic bounding volume tree: every leaf holds a fat box (the body's box
+// grown by a margin and stretched along its expected motion), inner nodes
+// the union of their children. Leaves are inserted where the surface area
+// heuristic says the tree grows least and ancestors are refitted and
+// rotated back into balance on the way up. A body moving inside its fat box
+// costs nothing, one leaving it is removed and inserted again.
+class DynamicAabbTree
+{
+public:
+    DynamicAabbTree();
+    void clear();
+    void setMargin(GLfloat margin);
+
+    int insert(const Aabb &box, int body); // returns the proxy of the leaf
+    void remove(int proxy);
+    // true if the leaf was reinserted; displacement: motion expected before
+    // the next move, the fat box is stretched to cover it
+    bool move(int proxy, const Aabb &box, const glm::vec3 &displacement);
+    const Aabb& fatBox(int proxy) const;
+    int height() const;
+
+    // visit(body) for every leaf whose fat box overlaps box, until it
+    // returns false
+    template<class Visit>
+    void query(const Aabb &box, Visit visit);
+
+    // visit(body, maxDistance) for every leaf whose fat box the ray hits
+    // within maxDistance, nearest subtrees first; it returns the distance
+    // the rest of the ray is clipped to (maxDistance to go on, 0 to stop).
+    // direction must be normalized
+    template<class Visit>
+    void raycast(const glm::vec3 &origin, const glm::vec3 &direction, GLfloat maxDistance,
+                 Visit visit);
+private:
+    struct Node
+    {
+        Aabb box;
+        int parent; // next free node while on the free list
+        int child1, child2; // -1 for leaves
+        int height; // leaves 0, -1 while free
+        int body;
+
+        bool leaf() const { return child1 < 0; }
+    };
+
+    int allocateNode();
+    void freeNode(int node);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    void refit(int node); // box and height from the children, then up to the root
+    int balance(int node);
+    Aabb fatten(const Aabb &box, const glm::vec3 &displacement) const;
+    static Aabb merge(const Aabb &a, const Aabb &b);
+    static GLfloat area(const Aabb &box);
+    static bool contains(const Aabb &outer, const Aabb &inner);
+    static bool hit(const Aabb &box, const glm::vec3 &origin, const glm::vec3 &inverse,
+                    GLfloat maxDistance, GLfloat &distance);
+
+    std::vector<Node> nodes_;
+    int root_;
+    int free_;
+    GLfloat margin_;
+    std::vector<int> stack_; // traversal, kept to not allocate per query
+};
+
+template<class Visit>
+void DynamicAabbTree::query(const Aabb &box, Visit visit)
+{
+    if (root_ < 0 || !overlap(nodes_[root_].box, box)) return;
+    // nodes on the stack are known to overlap
+    stack_.clear();
+    stack_.push_back(root_);
+    while (!stack_.empty())
+    {
+        const Node &node = nodes_[stack_.back()];
+        stack_.pop_back();
+        if (node.leaf())
+        {
+            if (!visit(node.body)) return;
+            continue;
+        }
+        if (overlap(nodes_[node.child1].box, box)) stack_.push_back(node.child1);
+        if (overlap(nodes_[node.child2].box, box)) stack_.push_back(node.child2);
+    }
+}
+
+template<class Visit>
+void DynamicAabbTree::raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                              GLfloat maxDistance, Visit visit)
+{
+    if (root_ < 0) return;
+    // 1/0 gives inf, which the slab test handles
+    glm::vec3 inverse = 1.0f / direction;
+    GLfloat distance;
+
+    stack_.clear();
+    stack_.push_back(root_);
+    while (!stack_.empty())
+    {
+        const Node &node = nodes_[stack_.back()];
+        stack_.pop_back();
+        // entered with a longer ray, it may have been clipped since
+        if (!hit(node.box, origin, inverse, maxDistance, distance)) continue;
+        if (node.leaf())
+        {
+            maxDistance = visit(node.body, maxDistance);
+            if (maxDistance <= 0) return;
+            continue;
+        }
+
+        GLfloat distance1, distance2;
+        bool hit1 = hit(nodes_[node.child1].box, origin, inverse, maxDistance, distance1);
+        bool hit2 = hit(nodes_[node.child2].box, origin, inverse, maxDistance, distance2);
+        if (hit1 && hit2)
+        {
+            // the nearer one on top
+            bool first = distance1 <= distance2;
+            stack_.push_back(first ? node.child2 : node.child1);
+            stack_.push_back(first ? node.child1 : node.child2);
+        }
+        else if (hit1) stack_.push_back(node.child1);
+        else if (hit2) stack_.push_back(node.child2);
+    }
+}
+
+}
+
+#endif // ENGINE_AABB_TREE_HPP
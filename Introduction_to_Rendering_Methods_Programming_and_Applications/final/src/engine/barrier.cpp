@@ -0,0 +1,38 @@
+#include "engine/barrier.hpp"
+
+#include <thread>
+
+namespace Engine
+{
+
+Barrier::Barrier(unsigned int count, unsigned int spin)
+    : count_{count}, spin_{spin}, waiting_{0}, generation_{0}
+{}
+
+void Barrier::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    unsigned long generation = generation_.load();
+
+    if (++waiting_ == count_)
+    {
+        waiting_ = 0;
+        generation_.store(generation + 1);
+        lock.unlock();
+        cv_.notify_all();
+        return;
+    }
+
+    // spin first, the last thread usually arrives within microseconds
+    lock.unlock();
+    for (unsigned int i=0; i<spin_; i++)
+    {
+        if (generation_.load(std::memory_order_acquire) != generation) return;
+        std::this_thread::yield();
+    }
+
+    lock.lock();
+    cv_.wait(lock, [&] { return generation_.load() != generation; });
+}
+
+} // namespace Engine
@@ -0,0 +1,33 @@
+#ifndef ENGINE_BARRIER_HPP
+#define ENGINE_BARRIER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace Engine
+{
+
+// reusable barrier for a fixed group of threads; waiters spin briefly
+// before blocking so short phases don't pay for a full sleep/wake cycle
+class Barrier
+{
+public:
+    explicit Barrier(unsigned int count, unsigned int spin = 4096);
+
+    Barrier(const Barrier &other) = delete;
+    Barrier &operator=(const Barrier &other) = delete;
+
+    void wait();
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    const unsigned int count_;
+    const unsigned int spin_;
+    unsigned int waiting_;
+    std::atomic<unsigned long> generation_;
+};
+
+}
+
+#endif // ENGINE_BARRIER_HPP
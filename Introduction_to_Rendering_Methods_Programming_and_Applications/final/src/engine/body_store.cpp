@@ -0,0 +1,77 @@
+#include "engine/body_store.hpp"
+
+namespace Engine
+{
+
+void BodyStore::clear()
+{
+    px.clear(); py.clear(); pz.clear();
+    vx.clear(); vy.clear(); vz.clear();
+    ax.clear(); ay.clear(); az.clear();
+    mass.clear();
+    rx.clear(); ry.clear(); rz.clear();
+    bound.clear();
+    for (auto &axis : axes) axis.clear();
+    types.clear();
+    flags.clear();
+}
+
+int BodyStore::add(const Scene::Body::PhysicalState &state)
+{
+    px.push_back(state.centroid.x);
+    py.push_back(state.centroid.y);
+    pz.push_back(state.centroid.z);
+    vx.push_back(state.velocity.x);
+    vy.push_back(state.velocity.y);
+    vz.push_back(state.velocity.z);
+    ax.push_back(0);
+    ay.push_back(0);
+    az.push_back(0);
+    mass.push_back(state.mass);
+    rx.push_back(state.radius.x);
+    ry.push_back(state.radius.y);
+    rz.push_back(state.radius.z);
+    bound.push_back(state.type == Scene::Body::Type::Sphere ? state.radius.x : glm::length(state.radius));
+    for (int k=0; k<3; k++) axes[k].push_back(state.normals[k]);
+    types.push_back((std::uint8_t)state.type);
+    flags.push_back(state.movable ? Flag::Movable : 0);
+    return size() - 1;
+}
+
+int BodyStore::size() const { return (int)px.size(); }
+
+glm::vec3 BodyStore::position(int i) const { return glm::vec3(px[i], py[i], pz[i]); }
+
+void BodyStore::setPosition(int i, const glm::vec3 &position)
+{
+    px[i] = position.x;
+    py[i] = position.y;
+    pz[i] = position.z;
+}
+
+glm::vec3 BodyStore::velocity(int i) const { return glm::vec3(vx[i], vy[i], vz[i]); }
+
+void BodyStore::setVelocity(int i, const glm::vec3 &velocity)
+{
+    vx[i] = velocity.x;
+    vy[i] = velocity.y;
+    vz[i] = velocity.z;
+}
+
+glm::vec3 BodyStore::radius(int i) const { return glm::vec3(rx[i], ry[i], rz[i]); }
+
+Scene::Body::Type BodyStore::type(int i) const { return (Scene::Body::Type)types[i]; }
+
+bool BodyStore::movable(int i) const { return flags[i] & Flag::Movable; }
+
+bool BodyStore::sleeping(int i) const { return flags[i] & Flag::Sleeping; }
+
+void BodyStore::setSleeping(int i, bool sleeping)
+{
+    if (sleeping) flags[i] |= Flag::Sleeping;
+    else flags[i] &= (std::uint8_t)~Flag::Sleeping;
+}
+
+bool BodyStore::active(int i) const { return (flags[i] & (Flag::Movable | Flag::Sleeping)) == Flag::Movable; }
+
+} // namespace Engine
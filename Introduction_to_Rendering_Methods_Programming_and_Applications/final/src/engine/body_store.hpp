@@ -0,0 +1,104 @@
+#ifndef ENGINE_BODY_STORE_HPP
+#define ENGINE_BODY_STORE_HPP
+
+#include "scene/body.hpp"
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+namespace Engine
+{
+
+template<class T, std::size_t Alignment = 32>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+    template<class U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() = default;
+    template<class U> AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(std::size_t n);
+    void deallocate(T *p, std::size_t n);
+};
+
+template<class T, class U, std::size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &) { return true; }
+template<class T, class U, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &) { return false; }
+
+template<class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// structure of arrays of everything the physics kernels read per body,
+// index i of every array belongs to body i
+class BodyStore
+{
+public:
+    enum Flag : std::uint8_t
+    {
+        Movable = 1 << 0,
+        Sleeping = 1 << 1 // skipped until an awake body touches its island
+    };
+
+    void clear();
+    int add(const Scene::Body::PhysicalState &state);
+    int size() const;
+
+    glm::vec3 position(int i) const;
+    void setPosition(int i, const glm::vec3 &position);
+    glm::vec3 velocity(int i) const;
+    void setVelocity(int i, const glm::vec3 &velocity);
+    glm::vec3 radius(int i) const;
+    Scene::Body::Type type(int i) const;
+    bool movable(int i) const;
+    bool sleeping(int i) const;
+    void setSleeping(int i, bool sleeping);
+    bool active(int i) const; // movable and awake
+
+    AlignedVector<GLfloat> px, py, pz; // centroid
+    AlignedVector<GLfloat> vx, vy, vz; // velocity
+    AlignedVector<GLfloat> ax, ay, az; // acceleration of the last force evaluation
+    AlignedVector<GLfloat> mass;
+    AlignedVector<GLfloat> rx, ry, rz; // sphere: rx, cube: half side lengths
+    AlignedVector<GLfloat> bound;      // radius of a sphere around the body
+    AlignedVector<glm::vec3> axes[3];  // box axes scaled by the half sides
+    AlignedVector<std::uint8_t> types;
+    AlignedVector<std::uint8_t> flags;
+};
+
+template<class T, std::size_t Alignment>
+T *AlignedAllocator<T, Alignment>::allocate(std::size_t n)
+{
+    void *p = nullptr;
+#if defined(_MSC_VER)
+    p = _aligned_malloc(n * sizeof(T), Alignment);
+#else
+    if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0) p = nullptr;
+#endif
+    if (!p) throw std::bad_alloc();
+    return static_cast<T *>(p);
+}
+
+template<class T, std::size_t Alignment>
+void AlignedAllocator<T, Alignment>::deallocate(T *p, std::size_t)
+{
+#if defined(_MSC_VER)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+}
+
+#endif // ENGINE_BODY_STORE_HPP
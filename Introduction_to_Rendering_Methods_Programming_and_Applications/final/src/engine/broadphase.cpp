@@ -0,0 +1,110 @@
+#include "engine/broadphase.hpp"
+
+#include <algorithm>
+
+namespace Engine
+{
+
+bool overlap(const Aabb &a, const Aabb &b)
+{
+    return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+           a.min.y <= b.max.y && b.min.y <= a.max.y &&
+           a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+SpatialHashGrid::SpatialHashGrid()
+    : cellSize_{1}, invCellSize_{1}, maxCellsPerBody_{64}
+{}
+
+void SpatialHashGrid::setCellSize(GLfloat cellSize)
+{
+    cellSize_ = cellSize;
+    invCellSize_ = 1 / cellSize;
+}
+
+GLfloat SpatialHashGrid::cellSize() const { return cellSize_; }
+
+void SpatialHashGrid::build(const std::vector<Aabb> &boxes)
+{
+    entries_.clear();
+    oversized_.clear();
+    pairs_.clear();
+
+    for (int i=0; i<(int)boxes.size(); i++)
+    {
+        glm::ivec3 lo = cell(boxes[i].min);
+        glm::ivec3 hi = cell(boxes[i].max);
+        glm::ivec3 span = hi - lo + 1;
+        if ((long long)span.x * span.y * span.z > maxCellsPerBody_)
+        {
+            oversized_.push_back(i);
+            continue;
+        }
+
+        for (int x=lo.x; x<=hi.x; x++)
+            for (int y=lo.y; y<=hi.y; y++)
+                for (int z=lo.z; z<=hi.z; z++)
+                    entries_.push_back(Entry{key(glm::ivec3(x, y, z)), i});
+    }
+
+    std::sort(entries_.begin(), entries_.end(),
+              [](const Entry &a, const Entry &b)
+              { return a.key < b.key || (a.key == b.key && a.body < b.body); });
+
+    // pairs sharing several cells are only reported by the cell holding the
+    // min corner of their overlap, so no duplicate removal is needed
+    for (int begin=0, end=0; begin<(int)entries_.size(); begin=end)
+    {
+        while (end < (int)entries_.size() && entries_[end].key == entries_[begin].key) end++;
+
+        for (int a=begin; a<end; a++)
+        {
+            for (int b=a+1; b<end; b++)
+            {
+                const Aabb &boxA = boxes[entries_[a].body];
+                const Aabb &boxB = boxes[entries_[b].body];
+                if (!overlap(boxA, boxB)) continue;
+                if (key(cell(glm::max(boxA.min, boxB.min))) != entries_[begin].key) continue;
+                pairs_.push_back(Pair{entries_[a].body, entries_[b].body});
+            }
+        }
+    }
+
+    for (int k=0; k<(int)oversized_.size(); k++)
+    {
+        int i = oversized_[k];
+        for (int j=0; j<(int)boxes.size(); j++)
+        {
+            // two oversized bodies are reported once, by the lower index
+            bool alsoOversized = std::binary_search(oversized_.begin(), oversized_.end(), j);
+            if (j == i || (alsoOversized && j < i)) continue;
+            if (overlap(boxes[i], boxes[j]))
+            {
+                pairs_.push_back(i < j ? Pair{i, j} : Pair{j, i});
+            }
+        }
+    }
+
+    std::sort(pairs_.begin(), pairs_.end());
+}
+
+const std::vector<SpatialHashGrid::Pair>& SpatialHashGrid::pairs() const { return pairs_; }
+
+glm::ivec3 SpatialHashGrid::cell(const glm::vec3 &point) const
+{
+    // keep coordinates inside the 21 bits each axis gets in the key
+    const GLfloat limit = (GLfloat)((1 << 20) - 1);
+    glm::vec3 c = glm::clamp(glm::floor(point * invCellSize_), -limit, limit);
+    return glm::ivec3(c);
+}
+
+std::uint64_t SpatialHashGrid::key(const glm::ivec3 &cell) const
+{
+    const std::uint64_t mask = (1u << 21) - 1;
+    const int offset = 1 << 20;
+    return ((std::uint64_t)(cell.x + offset) & mask) << 42 |
+           ((std::uint64_t)(cell.y + offset) & mask) << 21 |
+           ((std::uint64_t)(cell.z + offset) & mask);
+}
+
+} // namespace Engine
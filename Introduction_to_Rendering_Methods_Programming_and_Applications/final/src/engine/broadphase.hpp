@@ -0,0 +1,57 @@
+#ifndef ENGINE_BROADPHASE_HPP
+#define ENGINE_BROADPHASE_HPP
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Engine
+{
+
+struct Aabb
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+bool overlap(const Aabb &a, const Aabb &b);
+
+// uniform grid, cells are identified by packing their integer coordinates
+// into one key; bodies are bucketed by sorting (key, body) entries
+class SpatialHashGrid
+{
+public:
+    typedef std::pair<int, int> Pair;
+
+    SpatialHashGrid();
+    void setCellSize(GLfloat cellSize);
+    GLfloat cellSize() const;
+
+    // rebuild from scratch and collect pairs (i < j) with overlapping boxes
+    void build(const std::vector<Aabb> &boxes);
+    const std::vector<Pair>& pairs() const;
+private:
+    struct Entry
+    {
+        std::uint64_t key;
+        int body;
+    };
+
+    glm::ivec3 cell(const glm::vec3 &point) const;
+    std::uint64_t key(const glm::ivec3 &cell) const;
+
+    GLfloat cellSize_;
+    GLfloat invCellSize_;
+    int maxCellsPerBody_; // bigger bodies skip the grid and test everything
+
+    std::vector<Entry> entries_;
+    std::vector<int> oversized_;
+    std::vector<Pair> pairs_;
+};
+
+}
+
+#endif // ENGINE_BROADPHASE_HPP
@@ -0,0 +1,224 @@
+#include "engine/checkpoint.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if !defined(IOV_MAX)
+#define IOV_MAX 1024
+#endif
+
+namespace Engine
+{
+
+const std::uint32_t Checkpoint::Version;
+
+namespace
+{
+
+const char Magic[8] = {'P', 'H', 'Y', 'S', 'C', 'K', 'P', 'T'};
+const std::uint64_t HeaderSize = 16; // magic, version and part count
+
+// readv and writev may stop short, go on from where they did
+bool transfer(int fd, std::vector<iovec> parts, bool write)
+{
+    parts.erase(std::remove_if(parts.begin(), parts.end(), [](const iovec &p) { return p.iov_len == 0; }),
+                parts.end());
+    std::size_t first = 0;
+    while (first < parts.size())
+    {
+        int count = (int)std::min<std::size_t>(parts.size() - first, IOV_MAX);
+        ssize_t done = write ? writev(fd, &parts[first], count) : readv(fd, &parts[first], count);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return false;
+
+        while (first < parts.size() && (std::size_t)done >= parts[first].iov_len)
+        {
+            done -= parts[first].iov_len;
+            first++;
+        }
+        if (first < parts.size())
+        {
+            parts[first].iov_base = static_cast<char*>(parts[first].iov_base) + done;
+            parts[first].iov_len -= done;
+        }
+    }
+    return true;
+}
+
+}
+
+Checkpoint::Checkpoint()
+    : fd_{-1}, restoring_{false}, failed_{false}, bytes_{0}
+{}
+
+Checkpoint::~Checkpoint()
+{
+    close();
+}
+
+bool Checkpoint::create(const std::string &path)
+{
+    close();
+    path_ = path;
+    restoring_ = false;
+    failed_ = false;
+    parts_.clear();
+    bytes_ = 0;
+    fd_ = ::open((path + ".tmp").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+    {
+        std::cerr << "[ERROR] Failed to create checkpoint file: " << path << ".tmp" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Checkpoint::open(const std::string &path)
+{
+    close();
+    path_ = path;
+    restoring_ = true;
+    failed_ = false;
+    parts_.clear();
+    bytes_ = 0;
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+        std::cerr << "[ERROR] Failed to open checkpoint file: " << path << std::endl;
+        return false;
+    }
+
+    char magic[8];
+    std::uint32_t version = 0, count = 0;
+    std::vector<iovec> header{{magic, sizeof(magic)}, {&version, sizeof(version)}, {&count, sizeof(count)}};
+    if (!transfer(fd_, header, false) || std::memcmp(magic, Magic, sizeof(Magic)) != 0)
+    {
+        std::cerr << "[ERROR] Not a checkpoint file: " << path << std::endl;
+        close();
+        return false;
+    }
+    if (version != Version)
+    {
+        std::cerr << "[ERROR] Checkpoint version " << version << " can't be restored, expected "
+                  << Version << ": " << path << std::endl;
+        close();
+        return false;
+    }
+
+    // nothing is sized from the header before the file is known to hold it
+    struct stat status;
+    std::uint64_t left = 0;
+    if (fstat(fd_, &status) == 0 && (std::uint64_t)status.st_size >= HeaderSize)
+    {
+        left = (std::uint64_t)status.st_size - HeaderSize;
+    }
+    bool fits = count <= left / sizeof(std::uint64_t);
+    if (fits)
+    {
+        sizes_.resize(count);
+        fits = transfer(fd_, {{sizes_.data(), count * sizeof(std::uint64_t)}}, false);
+        left -= count * sizeof(std::uint64_t);
+    }
+    for (std::size_t k=0; fits && k<sizes_.size(); k++)
+    {
+        fits = sizes_[k] <= left;
+        left -= fits ? sizes_[k] : 0;
+    }
+    if (!fits)
+    {
+        std::cerr << "[ERROR] Checkpoint file is cut off: " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool Checkpoint::restoring() const { return restoring_; }
+
+void Checkpoint::text(std::string &text)
+{
+    std::size_t bytes = text.size();
+    if (restoring_)
+    {
+        if (!next(1, bytes)) return;
+        text.resize(bytes);
+    }
+    add(text.empty() ? nullptr : &text[0], bytes);
+}
+
+bool Checkpoint::commit()
+{
+    if (fd_ < 0) return false;
+    bool ok = !failed_;
+    if (restoring_)
+    {
+        // every part of the file listed, and each in the place it was saved from
+        if (ok && parts_.size() != sizes_.size()) ok = false;
+        if (!ok)
+        {
+            std::cerr << "[ERROR] Checkpoint doesn't match the layout of version " << Version << ": "
+                      << path_ << std::endl;
+        }
+        else if (!transfer(fd_, parts_, false))
+        {
+            std::cerr << "[ERROR] Checkpoint file is cut off: " << path_ << std::endl;
+            ok = false;
+        }
+        close();
+        return ok;
+    }
+
+    std::uint32_t version = Version, count = (std::uint32_t)parts_.size();
+    std::vector<std::uint64_t> sizes;
+    for (auto &part : parts_)
+    {
+        sizes.push_back(part.iov_len);
+    }
+    std::vector<iovec> all{{const_cast<char*>(Magic), sizeof(Magic)}, {&version, sizeof(version)},
+                           {&count, sizeof(count)}, {sizes.data(), sizes.size() * sizeof(std::uint64_t)}};
+    all.insert(all.end(), parts_.begin(), parts_.end());
+    ok = transfer(fd_, all, true) && ::close(fd_) == 0;
+    fd_ = -1;
+    if (!ok || std::rename((path_ + ".tmp").c_str(), path_.c_str()) != 0)
+    {
+        std::cerr << "[ERROR] Failed to write checkpoint file: " << path_ << std::endl;
+        std::remove((path_ + ".tmp").c_str());
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t Checkpoint::bytes() const { return bytes_; }
+
+bool Checkpoint::next(std::size_t element, std::size_t &bytes)
+{
+    if (parts_.size() >= sizes_.size() || sizes_[parts_.size()] % element != 0)
+    {
+        failed_ = true;
+        return false;
+    }
+    bytes = (std::size_t)sizes_[parts_.size()];
+    return true;
+}
+
+void Checkpoint::add(void *data, std::size_t bytes)
+{
+    parts_.push_back(iovec{data, bytes});
+    bytes_ += bytes;
+}
+
+void Checkpoint::close()
+{
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+} // namespace Engine
@@ -0,0 +1,89 @@
+#ifndef ENGINE_CHECKPOINT_HPP
+#define ENGINE_CHECKPOINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace Engine
+{
+
+// versioned binary snapshot of plain arrays. The owner of the state lists
+// its arrays and values through part() and value() in a fixed order, the
+// same for saving and restoring. Saving writes a header with the size of
+// every part, then all of them with one writev(). Restoring reads the
+// header first, so each array is resized as it is listed, then fills all
+// of them with one readv().
+//   header  char[8] "PHYSCKPT", uint32 version, uint32 parts, uint64 bytes per part
+//   parts   back to back, native byte order
+// A save goes to path.tmp and is renamed over path once complete, so a
+// crash while saving leaves the previous checkpoint intact.
+class Checkpoint
+{
+public:
+    static const std::uint32_t Version = 2; // bump whenever the parts change
+
+    Checkpoint();
+    ~Checkpoint();
+    Checkpoint(const Checkpoint &other) = delete;
+    Checkpoint &operator=(const Checkpoint &other) = delete;
+
+    bool create(const std::string &path); // to save
+    bool open(const std::string &path);   // to restore, reads the header
+    bool restoring() const;
+
+    template<class T, class A>
+    void part(std::vector<T, A> &values);
+    template<class T>
+    void value(T &value);
+    void text(std::string &text);
+
+    bool commit(); // writes or reads every part listed, then closes the file
+    std::uint64_t bytes() const; // of the parts listed so far
+private:
+    bool next(std::size_t element, std::size_t &bytes); // restore: size of the next part
+    void add(void *data, std::size_t bytes);
+    void close();
+
+    int fd_;
+    bool restoring_;
+    bool failed_;
+    std::string path_;
+    std::vector<std::uint64_t> sizes_; // restore: from the header
+    std::vector<iovec> parts_;
+    std::uint64_t bytes_;
+};
+
+template<class T, class A>
+void Checkpoint::part(std::vector<T, A> &values)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "checkpoint parts are copied bytewise");
+    std::size_t bytes = values.size() * sizeof(T);
+    if (restoring_)
+    {
+        if (!next(sizeof(T), bytes)) return;
+        values.resize(bytes / sizeof(T));
+    }
+    add(values.data(), bytes);
+}
+
+template<class T>
+void Checkpoint::value(T &value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "checkpoint parts are copied bytewise");
+    std::size_t bytes = sizeof(T);
+    if (restoring_ && (!next(sizeof(T), bytes) || bytes != sizeof(T)))
+    {
+        failed_ = true;
+        return;
+    }
+    add(&value, sizeof(T));
+}
+
+}
+
+#endif // ENGINE_CHECKPOINT_HPP
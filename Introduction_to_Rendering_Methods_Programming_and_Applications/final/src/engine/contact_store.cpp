@@ -0,0 +1,140 @@
+#include "engine/contact_store.hpp"
+
+#include <algorithm>
+
+namespace Engine
+{
+
+const std::uint64_t ContactStore::Empty;
+const int ContactStore::MaxPoints;
+
+ContactStore::ContactStore() : tick_{0}
+{
+    rehash(64);
+}
+
+void ContactStore::begin()
+{
+    tick_++;
+}
+
+ContactStore::Contact &ContactStore::touch(int body1, int body2)
+{
+    if (body1 > body2) std::swap(body1, body2);
+
+    if ((contacts_.size() + 1) * 2 > keys_.size()) rehash(keys_.size() * 2);
+
+    std::uint64_t k = key(body1, body2);
+    std::size_t s = slot(k);
+    while (keys_[s] != Empty && keys_[s] != k) s = (s + 1) & (keys_.size() - 1);
+
+    if (keys_[s] == Empty)
+    {
+        keys_[s] = k;
+        index_[s] = (int)contacts_.size();
+        Contact contact{};
+        contact.body1 = body1;
+        contact.body2 = body2;
+        contact.tick = tick_;
+        contacts_.push_back(contact);
+        return contacts_.back();
+    }
+
+    // first report this tick starts from a clean slate, except for the
+    // impulses of a contact that was touching last tick
+    Contact &contact = contacts_[index_[s]];
+    if (contact.tick != tick_)
+    {
+        bool kept = contact.tick + 1 == tick_;
+        contact.age = kept ? contact.age + 1 : 0;
+        contact.tick = tick_;
+        contact.sink = 0;
+        contact.depth = 0;
+        contact.normal = glm::vec3{0};
+        contact.pointCount = 0;
+        if (!kept)
+        {
+            contact.impulse = 0;
+            contact.friction = glm::vec3{0};
+        }
+    }
+    return contact;
+}
+
+void ContactStore::end()
+{
+    // compact the live contacts, then rebuild the index (O(contacts))
+    auto stale = [&](const Contact &contact) { return contact.tick != tick_; };
+    contacts_.erase(std::remove_if(contacts_.begin(), contacts_.end(), stale), contacts_.end());
+
+    std::size_t capacity = keys_.size();
+    while (capacity > 64 && contacts_.size() * 8 < capacity) capacity /= 2;
+    rehash(capacity);
+}
+
+ContactStore::Contact *ContactStore::find(int body1, int body2)
+{
+    if (body1 > body2) std::swap(body1, body2);
+
+    std::uint64_t k = key(body1, body2);
+    for (std::size_t s = slot(k); keys_[s] != Empty; s = (s + 1) & (keys_.size() - 1))
+    {
+        if (keys_[s] == k) return &contacts_[index_[s]];
+    }
+    return nullptr;
+}
+
+const std::vector<ContactStore::Contact>& ContactStore::contacts() const { return contacts_; }
+
+std::vector<ContactStore::Contact>& ContactStore::contacts() { return contacts_; }
+
+void ContactStore::clear()
+{
+    contacts_.clear();
+    rehash(64);
+}
+
+void ContactStore::checkpoint(Checkpoint &checkpoint)
+{
+    checkpoint.part(contacts_);
+    checkpoint.part(keys_);
+    checkpoint.part(index_);
+    checkpoint.value(tick_);
+}
+
+bool ContactStore::consistent() const
+{
+    if (keys_.size() < 64 || (keys_.size() & (keys_.size() - 1)) != 0 || index_.size() != keys_.size()) return false;
+    for (std::size_t s=0; s<keys_.size(); s++)
+    {
+        if (keys_[s] != Empty && (index_[s] < 0 || index_[s] >= (int)contacts_.size())) return false;
+    }
+    return true;
+}
+
+std::uint64_t ContactStore::key(int body1, int body2)
+{
+    return (std::uint64_t)(std::uint32_t)body1 << 32 | (std::uint32_t)body2;
+}
+
+std::size_t ContactStore::slot(std::uint64_t key) const
+{
+    // fibonacci hashing spreads the packed indices over the table
+    return (std::size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (keys_.size() - 1);
+}
+
+void ContactStore::rehash(std::size_t capacity)
+{
+    keys_.assign(capacity, Empty);
+    index_.assign(capacity, -1);
+    for (int i=0; i<(int)contacts_.size(); i++)
+    {
+        std::uint64_t k = key(contacts_[i].body1, contacts_[i].body2);
+        std::size_t s = slot(k);
+        while (keys_[s] != Empty) s = (s + 1) & (capacity - 1);
+        keys_[s] = k;
+        index_[s] = i;
+    }
+}
+
+} // namespace Engine
@@ -0,0 +1,63 @@
+#ifndef ENGINE_CONTACT_STORE_HPP
+#define ENGINE_CONTACT_STORE_HPP
+
+#include "engine/checkpoint.hpp"
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Engine
+{
+
+// contacts of the current tick keyed by body pair, kept densely in an array
+// and indexed by a flat open addressing (linear probing) hash table
+class ContactStore
+{
+public:
+    static const int MaxPoints = 4;
+
+    struct Contact
+    {
+        int body1, body2;   // body1 < body2
+        GLfloat sink;       // penetration, negative while overlapping
+        GLfloat depth;      // (m) overlap along the normal
+        glm::vec3 normal;   // pushes body1 away from body2 (not normalized)
+        glm::vec3 points[MaxPoints]; // world space, between the two surfaces
+        int pointCount;
+        GLfloat impulse;    // (N s) accumulated normal impulse, warm starts the next tick
+        glm::vec3 friction; // (N s) accumulated tangent impulse
+        unsigned int age;   // ticks the contact has been touching
+        unsigned int tick;  // last tick the contact was reported
+    };
+
+    ContactStore();
+
+    // contacts not touched between begin() and end() are dropped at end()
+    void begin();
+    Contact &touch(int body1, int body2);
+    void end();
+
+    Contact *find(int body1, int body2);
+    const std::vector<Contact>& contacts() const;
+    std::vector<Contact>& contacts();
+    void clear();
+    void checkpoint(Checkpoint &checkpoint); // lists the store, table included
+    bool consistent() const;                 // of a restored store
+private:
+    static const std::uint64_t Empty = ~(std::uint64_t)0;
+
+    static std::uint64_t key(int body1, int body2);
+    std::size_t slot(std::uint64_t key) const;
+    void rehash(std::size_t capacity);
+
+    std::vector<Contact> contacts_;
+    std::vector<std::uint64_t> keys_; // capacity is a power of two
+    std::vector<int> index_;          // keys_[s] -> contacts_[index_[s]]
+    unsigned int tick_;
+};
+
+}
+
+#endif // ENGINE_CONTACT_STORE_HPP
@@ -0,0 +1,35 @@
+#include "engine/disjoint_set.hpp"
+
+#include <utility>
+
+namespace Engine
+{
+
+void DisjointSet::reset(int n)
+{
+    parent_.resize(n);
+    size_.assign(n, 1);
+    for (int i=0; i<n; i++) parent_[i] = i;
+}
+
+int DisjointSet::find(int i)
+{
+    while (parent_[i] != i)
+    {
+        parent_[i] = parent_[parent_[i]];
+        i = parent_[i];
+    }
+    return i;
+}
+
+void DisjointSet::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    if (a == b) return;
+    if (size_[a] < size_[b]) std::swap(a, b);
+    parent_[b] = a;
+    size_[a] += size_[b];
+}
+
+} // namespace Engine
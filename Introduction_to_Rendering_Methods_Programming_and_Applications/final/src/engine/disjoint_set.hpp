@@ -0,0 +1,23 @@
+#ifndef ENGINE_DISJOINT_SET_HPP
+#define ENGINE_DISJOINT_SET_HPP
+
+#include <vector>
+
+namespace Engine
+{
+
+// union-find over indices [0, n), union by size and path halving
+class DisjointSet
+{
+public:
+    void reset(int n);
+    int find(int i);
+    void unite(int a, int b);
+private:
+    std::vector<int> parent_;
+    std::vector<int> size_;
+};
+
+}
+
+#endif // ENGINE_DISJOINT_SET_HPP
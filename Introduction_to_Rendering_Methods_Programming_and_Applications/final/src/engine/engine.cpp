@@ -4,6 +4,7 @@
 #include "GLFW/glfw3.h"
 
 #include <iostream>
+#include <thread>
 
 namespace Engine
 {
@@ -19,7 +20,13 @@ Engine::Engine()
                                          windowSize,
                                          windowTitle));
 
-    physicsModule_ = std::make_shared<PhysicsModule>(tick);
+    // keep one core for the master thread, the rest go to the worker pool
+    PhysicsModule::Context physicsContext;
+    unsigned int cores = std::thread::hardware_concurrency();
+    physicsContext.threadNum = cores > 1 ? cores - 1 : 1;
+    physicsContext.affinity = false;
+
+    physicsModule_ = std::make_shared<PhysicsModule>(tick, physicsContext);
     physicsModule_->init();
     
 }
@@ -30,12 +37,25 @@ void Engine::loadScene(std::string sceneFile)
 {
     scene_ = std::make_shared<Scene::Scene>(sceneFile);
     physicsModule_->setScene(scene_);
+    renderModule_->setScene(scene_, physicsModule_->transforms());
+    renderModule_->setReplay(nullptr);
+    replay_.reset();
+}
+
+void Engine::loadReplay(std::string sceneFile, std::string trajectoryFile)
+{
+    // the scene is only needed for what the bodies look like
+    scene_ = std::make_shared<Scene::Scene>(sceneFile);
+    replay_ = std::make_shared<TrajectoryReader>();
+    if (!replay_->open(trajectoryFile)) exit(EXIT_FAILURE);
+    renderModule_->setScene(scene_, physicsModule_->transforms());
+    renderModule_->setReplay(replay_);
 }
 
 void Engine::start()
 {
-    physicsModule_->start();
-    renderModule_->loop(scene_);
+    if (!replay_) physicsModule_->start();
+    renderModule_->loop();
 }
 
 void Engine::finish() {}
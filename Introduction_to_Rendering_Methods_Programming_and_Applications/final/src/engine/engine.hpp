@@ -22,12 +22,16 @@ public:
     Engine &operator=(const Engine &other) = delete;
 
     void loadScene(std::string sceneFile);
+    // draws a recording of the scene (see PhysicsModule::Context::recordFile),
+    // physics does not run
+    void loadReplay(std::string sceneFile, std::string trajectoryFile);
     void start();
     void finish();
 private:
     std::shared_ptr<Scene::Scene> scene_;
     std::unique_ptr<RenderModule> renderModule_;
     std::shared_ptr<PhysicsModule> physicsModule_;
+    std::shared_ptr<TrajectoryReader> replay_;
 };
 
 }
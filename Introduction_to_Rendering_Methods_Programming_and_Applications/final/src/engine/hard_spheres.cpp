@@ -0,0 +1,260 @@
+#include "engine/hard_spheres.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Engine
+{
+
+HardSphereSystem::HardSphereSystem()
+    : now_{0}, collisions_{0}, stale_{0}
+{}
+
+bool HardSphereSystem::reset(const BodyStore &bodies)
+{
+    int n = bodies.size();
+    now_ = 0;
+    collisions_ = stale_ = 0;
+    spheres_.clear();
+    statics_.clear();
+    position_.resize(n);
+    velocity_.resize(n);
+    time_.assign(n, 0);
+    half_.resize(n);
+    mass_.resize(n);
+    sphere_.resize(n);
+    movable_.resize(n);
+    count_.assign(n, 0);
+    partner_.assign(n, -1);
+    for (int i=0; i<n; i++)
+    {
+        sphere_[i] = bodies.type(i) == Scene::Body::Type::Sphere;
+        movable_[i] = bodies.movable(i);
+        if (movable_[i] && !sphere_[i]) return false;
+
+        position_[i] = glm::dvec3(bodies.position(i));
+        velocity_[i] = movable_[i] ? glm::dvec3(bodies.velocity(i)) : glm::dvec3(0);
+        half_[i] = glm::dvec3(bodies.radius(i));
+        mass_[i] = bodies.mass[i] > 0 ? bodies.mass[i] : 1;
+        (movable_[i] ? spheres_ : statics_).push_back(i);
+    }
+    predictAll();
+    return true;
+}
+
+void HardSphereSystem::advance(double duration)
+{
+    double end = now_ + duration;
+    while (!events_.empty())
+    {
+        Event event = events_.front();
+        if (event.time > end) break;
+        std::pop_heap(events_.begin(), events_.end(), std::greater<Event>());
+        events_.pop_back();
+        if (count_[event.body] != event.count || count_[event.other] != event.otherCount)
+        {
+            stale_++;
+            continue;
+        }
+
+        now_ = event.time;
+        collide(event);
+
+        // stale events far ahead pile up, start over without them
+        if (events_.size() > 4 * spheres_.size() + 1024) predictAll();
+    }
+    now_ = end;
+}
+
+void HardSphereSystem::store(BodyStore &bodies) const
+{
+    for (int i : spheres_)
+    {
+        bodies.setPosition(i, glm::vec3(position(i, now_)));
+        bodies.setVelocity(i, glm::vec3(velocity_[i]));
+    }
+}
+
+double HardSphereSystem::now() const { return now_; }
+
+glm::dvec3 HardSphereSystem::position(int body, double time) const
+{
+    return position_[body] + velocity_[body] * (time - time_[body]);
+}
+
+unsigned long HardSphereSystem::collisions() const { return collisions_; }
+
+unsigned long HardSphereSystem::staleEvents() const { return stale_; }
+
+void HardSphereSystem::checkpoint(Checkpoint &checkpoint)
+{
+    checkpoint.value(now_);
+    checkpoint.value(collisions_);
+    checkpoint.value(stale_);
+    checkpoint.part(spheres_);
+    checkpoint.part(statics_);
+    checkpoint.part(position_);
+    checkpoint.part(velocity_);
+    checkpoint.part(time_);
+    checkpoint.part(half_);
+    checkpoint.part(mass_);
+    checkpoint.part(sphere_);
+    checkpoint.part(movable_);
+    checkpoint.part(count_);
+    checkpoint.part(partner_);
+    checkpoint.part(events_);
+}
+
+bool HardSphereSystem::consistent(int bodies) const
+{
+    std::size_t n = (std::size_t)bodies;
+    if (position_.size() != n || velocity_.size() != n || time_.size() != n || half_.size() != n ||
+        mass_.size() != n || sphere_.size() != n || movable_.size() != n || count_.size() != n ||
+        partner_.size() != n || spheres_.size() + statics_.size() != n)
+    {
+        return false;
+    }
+    for (auto &event : events_)
+    {
+        if (event.body < 0 || event.body >= bodies || event.other < 0 || event.other >= bodies) return false;
+    }
+    return true;
+}
+
+void HardSphereSystem::predictAll()
+{
+    events_.clear();
+    for (int i : spheres_)
+    {
+        predict(i);
+    }
+}
+
+void HardSphereSystem::predict(int body)
+{
+    // only the earliest, whatever comes later is predicted again after it
+    double earliest = std::numeric_limits<double>::max(), time;
+    int other = -1, face = -1, boxFace;
+    for (int j : spheres_)
+    {
+        if (j != body && pairTime(body, j, time) && time < earliest)
+        {
+            earliest = time;
+            other = j;
+            face = -1;
+        }
+    }
+    for (int j : statics_)
+    {
+        bool hit = sphere_[j] ? pairTime(body, j, time) : boxTime(body, j, time, boxFace);
+        if (hit && time < earliest)
+        {
+            earliest = time;
+            other = j;
+            face = sphere_[j] ? -1 : boxFace;
+        }
+    }
+
+    partner_[body] = other;
+    if (other < 0) return;
+    events_.push_back(Event{earliest, body, other, face, count_[body], count_[other]});
+    std::push_heap(events_.begin(), events_.end(), std::greater<Event>());
+}
+
+bool HardSphereSystem::pairTime(int body, int other, double &time) const
+{
+    // |dp + dv t| = r1 + r2, the earlier root while approaching
+    glm::dvec3 dp = position(other, now_) - position(body, now_);
+    glm::dvec3 dv = velocity_[other] - velocity_[body];
+    double b = glm::dot(dp, dv);
+    if (b >= 0) return false;
+
+    double reach = half_[body].x + half_[other].x;
+    double a = glm::dot(dv, dv);
+    double c = glm::dot(dp, dp) - reach * reach;
+    double discriminant = b * b - a * c;
+    if (discriminant < 0) return false;
+
+    // touching or overlapping while approaching collides right away
+    time = now_ + (c <= 0 ? 0 : c / (-b + std::sqrt(discriminant)));
+    return true;
+}
+
+bool HardSphereSystem::boxTime(int body, int box, double &time, int &face) const
+{
+    // slabs of the box grown by the radius; edges and corners are square
+    // instead of rounded, so a sphere bounces off them a little early
+    glm::dvec3 p = position(body, now_);
+    const glm::dvec3 &v = velocity_[body];
+    double r = half_[body].x;
+    double enter = -std::numeric_limits<double>::max(), exit = std::numeric_limits<double>::max();
+    for (int k=0; k<3; k++)
+    {
+        double lo = position_[box][k] - half_[box][k] - r;
+        double hi = position_[box][k] + half_[box][k] + r;
+        // at rest along k, or too slow to reach the slab before overflowing
+        if (std::abs(v[k]) < std::numeric_limits<double>::min())
+        {
+            if (p[k] < lo || p[k] > hi) return false;
+            continue;
+        }
+        double t1 = (lo - p[k]) / v[k], t2 = (hi - p[k]) / v[k];
+        if (t1 > t2) std::swap(t1, t2);
+        if (t1 > enter)
+        {
+            enter = t1;
+            face = k * 2 + (v[k] < 0 ? 1 : 0);
+        }
+        exit = std::min(exit, t2);
+    }
+    // entered before now: it is leaving or already inside
+    if (enter > exit || enter < 0) return false;
+
+    time = now_ + enter;
+    return true;
+}
+
+void HardSphereSystem::collide(const Event &event)
+{
+    int a = event.body, b = event.other;
+    moveTo(a, now_);
+    collisions_++;
+
+    if (movable_[b])
+    {
+        // elastic, along the line of centers
+        moveTo(b, now_);
+        glm::dvec3 normal = glm::normalize(position_[b] - position_[a]);
+        double approach = glm::dot(velocity_[a] - velocity_[b], normal);
+        double j = 2 * approach / (1 / mass_[a] + 1 / mass_[b]);
+        velocity_[a] -= normal * (j / mass_[a]);
+        velocity_[b] += normal * (j / mass_[b]);
+        count_[b]++;
+    }
+    else if (event.face >= 0)
+    {
+        // static bodies don't move, the sphere is reflected
+        velocity_[a][event.face / 2] = -velocity_[a][event.face / 2];
+    }
+    else
+    {
+        glm::dvec3 normal = glm::normalize(position_[b] - position_[a]);
+        velocity_[a] -= normal * (2 * glm::dot(velocity_[a], normal));
+    }
+    count_[a]++;
+
+    // events of spheres expecting a or b are stale now
+    for (int i : spheres_)
+    {
+        if (i == a || i == b || partner_[i] == a || (movable_[b] && partner_[i] == b)) predict(i);
+    }
+}
+
+void HardSphereSystem::moveTo(int body, double time)
+{
+    position_[body] = position(body, time);
+    time_[body] = time;
+}
+
+} // namespace Engine
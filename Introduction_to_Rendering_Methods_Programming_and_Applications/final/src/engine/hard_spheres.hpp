@@ -0,0 +1,80 @@
+#ifndef ENGINE_HARD_SPHERES_HPP
+#define ENGINE_HARD_SPHERES_HPP
+
+#include "engine/body_store.hpp"
+#include "engine/checkpoint.hpp"
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Engine
+{
+
+// event-driven simulation of hard spheres moving freely between elastic
+// collisions with each other and with static bodies (spheres, axis aligned
+// boxes). Collision times are predicted exactly and every sphere keeps its
+// earliest one in a priority queue; an event is stale once either body
+// collided since it was predicted and is dropped when it comes up, and the
+// spheres that expected to hit one of the two look again. Every body
+// carries the time its position belongs to, so an event only moves the
+// bodies it involves. State is kept in double, in float repeated contacts
+// lose their order.
+class HardSphereSystem
+{
+public:
+    HardSphereSystem();
+
+    // movable bodies must be spheres, returns false otherwise
+    bool reset(const BodyStore &bodies);
+    void advance(double duration);   // run every collision until now + duration
+    void store(BodyStore &bodies) const; // positions and velocities at now
+
+    double now() const;
+    glm::dvec3 position(int body, double time) const; // time >= now
+    unsigned long collisions() const;
+    unsigned long staleEvents() const;
+    void checkpoint(Checkpoint &checkpoint); // lists the whole state, events included
+    bool consistent(int bodies) const;       // of a restored state
+private:
+    struct Event
+    {
+        double time;
+        int body;      // movable sphere
+        int other;     // movable sphere or static body
+        int face;      // box faces: axis * 2 + (max side), -1 otherwise
+        unsigned long count, otherCount; // collisions of both when predicted
+
+        bool operator>(const Event &e) const { return time > e.time; }
+    };
+
+    void predictAll();
+    void predict(int body);
+    bool pairTime(int body, int other, double &time) const;
+    bool boxTime(int body, int box, double &time, int &face) const;
+    void collide(const Event &event);
+    void moveTo(int body, double time);
+
+    double now_;
+    unsigned long collisions_;
+    unsigned long stale_;
+
+    std::vector<int> spheres_; // movable
+    std::vector<int> statics_;
+    std::vector<glm::dvec3> position_; // at time_
+    std::vector<glm::dvec3> velocity_;
+    std::vector<double> time_;
+    std::vector<glm::dvec3> half_; // sphere: radius in x, box: half extents
+    std::vector<double> mass_;
+    std::vector<std::uint8_t> sphere_;
+    std::vector<std::uint8_t> movable_;
+    std::vector<unsigned long> count_; // collisions so far
+    std::vector<int> partner_;         // of the earliest predicted collision, -1: none
+
+    std::vector<Event> events_; // min heap on time
+};
+
+}
+
+#endif // ENGINE_HARD_SPHERES_HPP
@@ -0,0 +1,327 @@
+#include "engine/kernels.hpp"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define KERNELS_TARGET_AVX2
+#else
+#define KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+// scalar versions, also the tails of the SIMD ones; the arithmetic is kept
+// in the same order as the SIMD lanes so both agree per pair
+
+void gravityRowScalar(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                      const GLfloat *mass, int begin, int end,
+                      const glm::vec3 &s, GLfloat Gm, GLfloat eps,
+                      GLfloat *fx, GLfloat *fy, GLfloat *fz, glm::vec3 &sum)
+{
+    GLfloat sfx = 0, sfy = 0, sfz = 0;
+    for (int t=begin; t<end; t++)
+    {
+        GLfloat dx = px[t] - s.x, dy = py[t] - s.y, dz = pz[t] - s.z;
+        GLfloat r = std::sqrt(dx*dx + dy*dy + dz*dz);
+        GLfloat f = Gm * mass[t] / ((r*r + eps) * (r + eps));
+        sfx += f * dx;
+        sfy += f * dy;
+        sfz += f * dz;
+        fx[t] -= f * dx;
+        fy[t] -= f * dy;
+        fz[t] -= f * dz;
+    }
+    sum += glm::vec3(sfx, sfy, sfz);
+}
+
+int sphereOverlapScalar(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                        const GLfloat *radius, int begin, int end,
+                        const glm::vec3 &s, GLfloat r, int *hits)
+{
+    int count = 0;
+    for (int t=begin; t<end; t++)
+    {
+        GLfloat dx = px[t] - s.x, dy = py[t] - s.y, dz = pz[t] - s.z;
+        GLfloat reach = r + radius[t];
+        if (dx*dx + dy*dy + dz*dz < reach * reach) hits[count++] = t;
+    }
+    return count;
+}
+
+#if defined(KERNELS_X86)
+
+void gravityRowSSE(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                   const GLfloat *mass, int begin, int end,
+                   const glm::vec3 &s, GLfloat Gm, GLfloat eps,
+                   GLfloat *fx, GLfloat *fy, GLfloat *fz, glm::vec3 &sum)
+{
+    const __m128 sx = _mm_set1_ps(s.x), sy = _mm_set1_ps(s.y), sz = _mm_set1_ps(s.z);
+    const __m128 gm = _mm_set1_ps(Gm), e = _mm_set1_ps(eps);
+    __m128 sfx = _mm_setzero_ps(), sfy = _mm_setzero_ps(), sfz = _mm_setzero_ps();
+    int t = begin;
+    for (; t+4<=end; t+=4)
+    {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(px + t), sx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(py + t), sy);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(pz + t), sz);
+        __m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 r = _mm_sqrt_ps(r2);
+        __m128 d = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(r, r), e), _mm_add_ps(r, e));
+        __m128 f = _mm_div_ps(_mm_mul_ps(gm, _mm_loadu_ps(mass + t)), d);
+        __m128 gx = _mm_mul_ps(f, dx), gy = _mm_mul_ps(f, dy), gz = _mm_mul_ps(f, dz);
+        sfx = _mm_add_ps(sfx, gx);
+        sfy = _mm_add_ps(sfy, gy);
+        sfz = _mm_add_ps(sfz, gz);
+        _mm_storeu_ps(fx + t, _mm_sub_ps(_mm_loadu_ps(fx + t), gx));
+        _mm_storeu_ps(fy + t, _mm_sub_ps(_mm_loadu_ps(fy + t), gy));
+        _mm_storeu_ps(fz + t, _mm_sub_ps(_mm_loadu_ps(fz + t), gz));
+    }
+
+    alignas(16) GLfloat lanes[3][4];
+    _mm_store_ps(lanes[0], sfx);
+    _mm_store_ps(lanes[1], sfy);
+    _mm_store_ps(lanes[2], sfz);
+    for (int k=0; k<4; k++) sum += glm::vec3(lanes[0][k], lanes[1][k], lanes[2][k]);
+    gravityRowScalar(px, py, pz, mass, t, end, s, Gm, eps, fx, fy, fz, sum);
+}
+
+int sphereOverlapSSE(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                     const GLfloat *radius, int begin, int end,
+                     const glm::vec3 &s, GLfloat r, int *hits)
+{
+    const __m128 sx = _mm_set1_ps(s.x), sy = _mm_set1_ps(s.y), sz = _mm_set1_ps(s.z);
+    const __m128 rs = _mm_set1_ps(r);
+    int count = 0;
+    int t = begin;
+    for (; t+4<=end; t+=4)
+    {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(px + t), sx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(py + t), sy);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(pz + t), sz);
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 reach = _mm_add_ps(rs, _mm_loadu_ps(radius + t));
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(d2, _mm_mul_ps(reach, reach)));
+        for (; mask; mask &= mask - 1)
+        {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            hits[count++] = t + lane;
+        }
+    }
+    return count + sphereOverlapScalar(px, py, pz, radius, t, end, s, r, hits + count);
+}
+
+KERNELS_TARGET_AVX2
+void gravityRowAVX2(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                    const GLfloat *mass, int begin, int end,
+                    const glm::vec3 &s, GLfloat Gm, GLfloat eps,
+                    GLfloat *fx, GLfloat *fy, GLfloat *fz, glm::vec3 &sum)
+{
+    const __m256 sx = _mm256_set1_ps(s.x), sy = _mm256_set1_ps(s.y), sz = _mm256_set1_ps(s.z);
+    const __m256 gm = _mm256_set1_ps(Gm), e = _mm256_set1_ps(eps);
+    __m256 sfx = _mm256_setzero_ps(), sfy = _mm256_setzero_ps(), sfz = _mm256_setzero_ps();
+    int t = begin;
+    for (; t+8<=end; t+=8)
+    {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(px + t), sx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(py + t), sy);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(pz + t), sz);
+        __m256 r2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                  _mm256_mul_ps(dz, dz));
+        __m256 r = _mm256_sqrt_ps(r2);
+        __m256 d = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(r, r), e), _mm256_add_ps(r, e));
+        __m256 f = _mm256_div_ps(_mm256_mul_ps(gm, _mm256_loadu_ps(mass + t)), d);
+        __m256 gx = _mm256_mul_ps(f, dx), gy = _mm256_mul_ps(f, dy), gz = _mm256_mul_ps(f, dz);
+        sfx = _mm256_add_ps(sfx, gx);
+        sfy = _mm256_add_ps(sfy, gy);
+        sfz = _mm256_add_ps(sfz, gz);
+        _mm256_storeu_ps(fx + t, _mm256_sub_ps(_mm256_loadu_ps(fx + t), gx));
+        _mm256_storeu_ps(fy + t, _mm256_sub_ps(_mm256_loadu_ps(fy + t), gy));
+        _mm256_storeu_ps(fz + t, _mm256_sub_ps(_mm256_loadu_ps(fz + t), gz));
+    }
+
+    alignas(32) GLfloat lanes[3][8];
+    _mm256_store_ps(lanes[0], sfx);
+    _mm256_store_ps(lanes[1], sfy);
+    _mm256_store_ps(lanes[2], sfz);
+    for (int k=0; k<8; k++) sum += glm::vec3(lanes[0][k], lanes[1][k], lanes[2][k]);
+    gravityRowSSE(px, py, pz, mass, t, end, s, Gm, eps, fx, fy, fz, sum);
+}
+
+KERNELS_TARGET_AVX2
+int sphereOverlapAVX2(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                      const GLfloat *radius, int begin, int end,
+                      const glm::vec3 &s, GLfloat r, int *hits)
+{
+    const __m256 sx = _mm256_set1_ps(s.x), sy = _mm256_set1_ps(s.y), sz = _mm256_set1_ps(s.z);
+    const __m256 rs = _mm256_set1_ps(r);
+    int count = 0;
+    int t = begin;
+    for (; t+8<=end; t+=8)
+    {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(px + t), sx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(py + t), sy);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(pz + t), sz);
+        __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                  _mm256_mul_ps(dz, dz));
+        __m256 reach = _mm256_add_ps(rs, _mm256_loadu_ps(radius + t));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(d2, _mm256_mul_ps(reach, reach), _CMP_LT_OQ));
+        for (; mask; mask &= mask - 1)
+        {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            hits[count++] = t + lane;
+        }
+    }
+    return count + sphereOverlapSSE(px, py, pz, radius, t, end, s, r, hits + count);
+}
+
+bool cpuHasAVX2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    return avx2 && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // KERNELS_X86
+
+#if defined(KERNELS_NEON)
+
+void gravityRowNEON(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                    const GLfloat *mass, int begin, int end,
+                    const glm::vec3 &s, GLfloat Gm, GLfloat eps,
+                    GLfloat *fx, GLfloat *fy, GLfloat *fz, glm::vec3 &sum)
+{
+    const float32x4_t sx = vdupq_n_f32(s.x), sy = vdupq_n_f32(s.y), sz = vdupq_n_f32(s.z);
+    const float32x4_t gm = vdupq_n_f32(Gm), e = vdupq_n_f32(eps);
+    float32x4_t sfx = vdupq_n_f32(0), sfy = vdupq_n_f32(0), sfz = vdupq_n_f32(0);
+    int t = begin;
+    for (; t+4<=end; t+=4)
+    {
+        float32x4_t dx = vsubq_f32(vld1q_f32(px + t), sx);
+        float32x4_t dy = vsubq_f32(vld1q_f32(py + t), sy);
+        float32x4_t dz = vsubq_f32(vld1q_f32(pz + t), sz);
+        float32x4_t r2 = vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_f32(dz, dz));
+        float32x4_t r = vsqrtq_f32(r2);
+        float32x4_t d = vmulq_f32(vaddq_f32(vmulq_f32(r, r), e), vaddq_f32(r, e));
+        float32x4_t f = vdivq_f32(vmulq_f32(gm, vld1q_f32(mass + t)), d);
+        float32x4_t gx = vmulq_f32(f, dx), gy = vmulq_f32(f, dy), gz = vmulq_f32(f, dz);
+        sfx = vaddq_f32(sfx, gx);
+        sfy = vaddq_f32(sfy, gy);
+        sfz = vaddq_f32(sfz, gz);
+        vst1q_f32(fx + t, vsubq_f32(vld1q_f32(fx + t), gx));
+        vst1q_f32(fy + t, vsubq_f32(vld1q_f32(fy + t), gy));
+        vst1q_f32(fz + t, vsubq_f32(vld1q_f32(fz + t), gz));
+    }
+
+    GLfloat lanes[3][4];
+    vst1q_f32(lanes[0], sfx);
+    vst1q_f32(lanes[1], sfy);
+    vst1q_f32(lanes[2], sfz);
+    for (int k=0; k<4; k++) sum += glm::vec3(lanes[0][k], lanes[1][k], lanes[2][k]);
+    gravityRowScalar(px, py, pz, mass, t, end, s, Gm, eps, fx, fy, fz, sum);
+}
+
+int sphereOverlapNEON(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                      const GLfloat *radius, int begin, int end,
+                      const glm::vec3 &s, GLfloat r, int *hits)
+{
+    const float32x4_t sx = vdupq_n_f32(s.x), sy = vdupq_n_f32(s.y), sz = vdupq_n_f32(s.z);
+    const float32x4_t rs = vdupq_n_f32(r);
+    int count = 0;
+    int t = begin;
+    for (; t+4<=end; t+=4)
+    {
+        float32x4_t dx = vsubq_f32(vld1q_f32(px + t), sx);
+        float32x4_t dy = vsubq_f32(vld1q_f32(py + t), sy);
+        float32x4_t dz = vsubq_f32(vld1q_f32(pz + t), sz);
+        float32x4_t d2 = vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_f32(dz, dz));
+        float32x4_t reach = vaddq_f32(rs, vld1q_f32(radius + t));
+        std::uint32_t lanes[4];
+        vst1q_u32(lanes, vcltq_f32(d2, vmulq_f32(reach, reach)));
+        for (int lane=0; lane<4; lane++)
+        {
+            if (lanes[lane]) hits[count++] = t + lane;
+        }
+    }
+    return count + sphereOverlapScalar(px, py, pz, radius, t, end, s, r, hits + count);
+}
+
+#endif // KERNELS_NEON
+
+}
+
+namespace Engine
+{
+
+Kernels Kernels::select(Isa isa)
+{
+    if (isa == Isa::Auto)
+    {
+        isa = supported(Isa::AVX2) ? Isa::AVX2 :
+              supported(Isa::NEON) ? Isa::NEON :
+              supported(Isa::SSE) ? Isa::SSE : Isa::Scalar;
+    }
+    if (!supported(isa)) isa = Isa::Scalar;
+
+    switch (isa)
+    {
+#if defined(KERNELS_X86)
+        case Isa::SSE: return Kernels{isa, gravityRowSSE, sphereOverlapSSE};
+        case Isa::AVX2: return Kernels{isa, gravityRowAVX2, sphereOverlapAVX2};
+#endif
+#if defined(KERNELS_NEON)
+        case Isa::NEON: return Kernels{isa, gravityRowNEON, sphereOverlapNEON};
+#endif
+        default: return Kernels{Isa::Scalar, gravityRowScalar, sphereOverlapScalar};
+    }
+}
+
+bool Kernels::supported(Isa isa)
+{
+    switch (isa)
+    {
+        case Isa::Scalar: return true;
+#if defined(KERNELS_X86)
+        case Isa::SSE: return true; // part of x86-64
+        case Isa::AVX2: return cpuHasAVX2();
+#endif
+#if defined(KERNELS_NEON)
+        case Isa::NEON: return true; // part of aarch64
+#endif
+        default: return false;
+    }
+}
+
+const char *Kernels::name(Isa isa)
+{
+    switch (isa)
+    {
+        case Isa::Auto: return "auto";
+        case Isa::Scalar: return "scalar";
+        case Isa::SSE: return "sse";
+        case Isa::AVX2: return "avx2";
+        case Isa::NEON: return "neon";
+        default: return "unknown";
+    }
+}
+
+} // namespace Engine
@@ -0,0 +1,49 @@
+#ifndef ENGINE_KERNELS_HPP
+#define ENGINE_KERNELS_HPP
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+namespace Engine
+{
+
+// inner loops of the physics over contiguous body arrays, in a scalar
+// version and 4/8 wide SIMD versions; one set is picked when the physics
+// is created, by what the CPU supports
+struct Kernels
+{
+    enum Isa
+    {
+        Auto,   // best the CPU supports
+        Scalar, // reference, same results as the loops it replaced
+        SSE,    // x86-64, 4 lanes
+        AVX2,   // x86-64 with AVX2 at runtime, 8 lanes
+        NEON    // aarch64, 4 lanes
+    };
+
+    // one row of the exact gravity sum: pairs (s, t) for t in [begin, end),
+    // f = Gm m[t] / ((r^2 + eps)(r + eps)) along d = p[t] - s; t gets -f d,
+    // the sum of f d is added to sum
+    typedef void (*GravityRow)(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                               const GLfloat *mass, int begin, int end,
+                               const glm::vec3 &s, GLfloat Gm, GLfloat eps,
+                               GLfloat *fx, GLfloat *fy, GLfloat *fz, glm::vec3 &sum);
+
+    // t in [begin, end) with |p[t] - s|^2 < (r + radius[t])^2, ascending
+    // into hits (room for end - begin); returns how many
+    typedef int (*SphereOverlap)(const GLfloat *px, const GLfloat *py, const GLfloat *pz,
+                                 const GLfloat *radius, int begin, int end,
+                                 const glm::vec3 &s, GLfloat r, int *hits);
+
+    Isa isa;
+    GravityRow gravityRow;
+    SphereOverlap sphereOverlap;
+
+    static Kernels select(Isa isa); // unsupported ones fall back to Scalar
+    static bool supported(Isa isa);
+    static const char *name(Isa isa);
+};
+
+}
+
+#endif // ENGINE_KERNELS_HPP
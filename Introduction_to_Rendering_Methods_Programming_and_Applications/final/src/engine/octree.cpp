@@ -0,0 +1,252 @@
+#include "engine/octree.hpp"
+
+#include <algorithm>
+
+namespace Engine
+{
+
+GravityOctree::GravityOctree()
+    : theta_{0.5f}, center_{0}, halfSize_{0}, root_{-1}
+{}
+
+void GravityOctree::setTheta(GLfloat theta) { theta_ = theta; }
+
+GLfloat GravityOctree::theta() const { return theta_; }
+
+void GravityOctree::prepare(const std::vector<glm::vec3> &positions,
+                            const std::vector<GLfloat> &masses)
+{
+    positions_ = positions;
+    masses_ = masses;
+    nodes_.clear();
+    root_ = -1;
+
+    // bounding cube of all bodies
+    glm::vec3 lo{0}, hi{0};
+    if (!positions_.empty()) lo = hi = positions_[0];
+    for (auto &p : positions_)
+    {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    center_ = (lo + hi) * 0.5f;
+    halfSize_ = std::max(glm::max(hi.x - lo.x, glm::max(hi.y - lo.y, hi.z - lo.z)) * 0.5f, 1e-6f);
+    halfSize_ *= 1.0001f; // keep bodies on the boundary strictly inside
+
+    // counting sort of bodies into the top level buckets
+    std::vector<int> bucket(positions_.size());
+    bucketOffsets_.fill(0);
+    for (int i=0; i<(int)positions_.size(); i++)
+    {
+        glm::vec3 t = (positions_[i] - (center_ - halfSize_)) / (2 * halfSize_) * (GLfloat)Side;
+        glm::ivec3 c = glm::clamp(glm::ivec3(t), 0, Side - 1);
+        bucket[i] = (c.x * Side + c.y) * Side + c.z;
+        bucketOffsets_[bucket[i] + 1]++;
+    }
+    for (int b=0; b<Side*Side*Side; b++)
+    {
+        bucketOffsets_[b + 1] += bucketOffsets_[b];
+    }
+    order_.resize(positions_.size());
+    std::array<int, Side*Side*Side + 1> fill = bucketOffsets_;
+    for (int i=0; i<(int)positions_.size(); i++)
+    {
+        order_[fill[bucket[i]]++] = i;
+    }
+}
+
+int GravityOctree::subtreeCount() const { return Side * Side * Side; }
+
+void GravityOctree::buildSubtree(int bucket)
+{
+    std::vector<Node> &nodes = subtrees_[bucket];
+    nodes.clear();
+    subtreeRoots_[bucket] = -1;
+
+    int count = bucketOffsets_[bucket + 1] - bucketOffsets_[bucket];
+    if (count == 0) return;
+
+    glm::ivec3 c{bucket / (Side * Side), (bucket / Side) % Side, bucket % Side};
+    GLfloat halfSize = halfSize_ / Side;
+    glm::vec3 center = center_ - halfSize_ + (glm::vec3(c) * 2.0f + 1.0f) * halfSize;
+    subtreeRoots_[bucket] = buildNode(nodes, bucketOffsets_[bucket], count, center, halfSize, Levels);
+}
+
+void GravityOctree::link()
+{
+    // subtrees are appended behind the top levels, so shift their indices
+    nodes_.clear();
+    std::array<int, Side*Side*Side> offsets;
+    std::size_t total = 0;
+    for (auto &subtree : subtrees_) total += subtree.size();
+    nodes_.reserve(total + 1 + 8);
+    for (int b=0; b<Side*Side*Side; b++)
+    {
+        offsets[b] = (int)nodes_.size();
+        for (Node node : subtrees_[b])
+        {
+            for (auto &child : node.children) if (child >= 0) child += offsets[b];
+            nodes_.push_back(node);
+        }
+        if (subtreeRoots_[b] >= 0) subtreeRoots_[b] += offsets[b];
+    }
+    root_ = linkNode(0, glm::ivec3(0));
+}
+
+glm::vec3 GravityOctree::force(int body, GLfloat G, GLfloat eps) const
+{
+    glm::vec3 F{0};
+    if (root_ < 0) return F;
+
+    const glm::vec3 p = positions_[body];
+    const GLfloat m = masses_[body];
+    const GLfloat theta2 = theta_ * theta_;
+
+    int stack[8 * (MaxDepth + 2)];
+    int top = 0;
+    stack[top++] = root_;
+    while (top > 0)
+    {
+        const Node &node = nodes_[stack[--top]];
+        if (node.mass <= 0) continue;
+
+        if (node.leaf)
+        {
+            for (int k=node.first; k<node.first+node.count; k++)
+            {
+                if (order_[k] == body) continue;
+                F += pairForce(positions_[order_[k]] - p, m, masses_[order_[k]], G, eps);
+            }
+            continue;
+        }
+
+        // far enough (s / d < theta) and not containing the body itself
+        glm::vec3 v = node.com - p;
+        GLfloat d2 = glm::dot(v, v);
+        GLfloat size = 2 * node.halfSize;
+        glm::vec3 offset = glm::abs(p - node.center);
+        bool inside = offset.x <= node.halfSize && offset.y <= node.halfSize && offset.z <= node.halfSize;
+        if (!inside && size * size < theta2 * d2)
+        {
+            F += pairForce(v, m, node.mass, G, eps);
+            continue;
+        }
+
+        for (int child : node.children)
+        {
+            if (child >= 0) stack[top++] = child;
+        }
+    }
+    return F;
+}
+
+int GravityOctree::buildNode(std::vector<Node> &nodes, int first, int count,
+                             glm::vec3 center, GLfloat halfSize, int depth)
+{
+    int index = (int)nodes.size();
+    Node node;
+    node.center = center;
+    node.halfSize = halfSize;
+    node.com = glm::vec3{0};
+    node.mass = 0;
+    node.first = first;
+    node.count = count;
+    node.children.fill(-1);
+    node.leaf = count == 1 || depth >= MaxDepth;
+    nodes.push_back(node);
+
+    if (nodes[index].leaf)
+    {
+        glm::vec3 weighted{0};
+        GLfloat mass = 0;
+        for (int k=first; k<first+count; k++)
+        {
+            weighted += positions_[order_[k]] * masses_[order_[k]];
+            mass += masses_[order_[k]];
+        }
+        nodes[index].mass = mass;
+        nodes[index].com = mass > 0 ? weighted / mass : center;
+        return index;
+    }
+
+    // partition bodies of this node into its octants
+    std::array<int, 9> offsets;
+    offsets.fill(0);
+    auto octant = [&](int body)
+    {
+        glm::vec3 p = positions_[body];
+        return (p.x >= center.x ? 4 : 0) | (p.y >= center.y ? 2 : 0) | (p.z >= center.z ? 1 : 0);
+    };
+    for (int k=first; k<first+count; k++) offsets[octant(order_[k]) + 1]++;
+    for (int o=0; o<8; o++) offsets[o + 1] += offsets[o];
+    std::vector<int> sorted(count);
+    std::array<int, 9> fill = offsets;
+    for (int k=first; k<first+count; k++) sorted[fill[octant(order_[k])]++] = order_[k];
+    std::copy(sorted.begin(), sorted.end(), order_.begin() + first);
+
+    GLfloat childHalf = halfSize * 0.5f;
+    for (int o=0; o<8; o++)
+    {
+        int childCount = offsets[o + 1] - offsets[o];
+        if (childCount == 0) continue;
+        glm::vec3 childCenter = center + childHalf * glm::vec3(o & 4 ? 1 : -1, o & 2 ? 1 : -1, o & 1 ? 1 : -1);
+        int child = buildNode(nodes, first + offsets[o], childCount, childCenter, childHalf, depth + 1);
+        nodes[index].children[o] = child;
+        accumulate(nodes[index], nodes[child]);
+    }
+    if (nodes[index].mass > 0) nodes[index].com /= nodes[index].mass;
+    else nodes[index].com = center;
+    return index;
+}
+
+int GravityOctree::linkNode(int level, glm::ivec3 cell)
+{
+    if (level == Levels)
+    {
+        return subtreeRoots_[(cell.x * Side + cell.y) * Side + cell.z];
+    }
+
+    int cells = 1 << level;
+    GLfloat halfSize = halfSize_ / static_cast<GLfloat>(cells);
+    Node node;
+    node.center = center_ - halfSize_ + (glm::vec3(cell) * 2.0f + 1.0f) * halfSize;
+    node.halfSize = halfSize;
+    node.com = glm::vec3{0};
+    node.mass = 0;
+    node.first = 0;
+    node.count = 0;
+    node.children.fill(-1);
+    node.leaf = false;
+
+    for (int o=0; o<8; o++)
+    {
+        glm::ivec3 childCell = cell * 2 + glm::ivec3(o & 4 ? 1 : 0, o & 2 ? 1 : 0, o & 1 ? 1 : 0);
+        int child = linkNode(level + 1, childCell);
+        if (child < 0) continue;
+        node.children[o] = child;
+        node.count += nodes_[child].count;
+        accumulate(node, nodes_[child]);
+    }
+    if (node.count == 0) return -1;
+    if (node.mass > 0) node.com /= node.mass;
+    else node.com = node.center;
+
+    nodes_.push_back(node);
+    return (int)nodes_.size() - 1;
+}
+
+void GravityOctree::accumulate(Node &node, const Node &child) const
+{
+    // com holds the mass weighted sum until the parent is complete
+    node.com += child.com * child.mass;
+    node.mass += child.mass;
+}
+
+glm::vec3 GravityOctree::pairForce(const glm::vec3 &v, GLfloat m1, GLfloat m2,
+                                   GLfloat G, GLfloat eps) const
+{
+    GLfloat r = glm::sqrt(glm::dot(v, v));
+    return (G*m1*m2) / (r*r + eps) * (v/(r+eps));
+}
+
+} // namespace Engine
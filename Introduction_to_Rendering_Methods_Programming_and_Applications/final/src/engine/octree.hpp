@@ -0,0 +1,70 @@
+#ifndef ENGINE_OCTREE_HPP
+#define ENGINE_OCTREE_HPP
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include <array>
+#include <vector>
+
+namespace Engine
+{
+
+// Barnes-Hut octree over point masses. The top two levels split space into
+// 64 buckets whose subtrees can be built independently (one per worker
+// event), then link() stitches them under the root:
+//     prepare() -> buildSubtree(0..subtreeCount()-1) -> link() -> force()
+class GravityOctree
+{
+public:
+    GravityOctree();
+    void setTheta(GLfloat theta); // opening angle, 0 degenerates to exact sum
+    GLfloat theta() const;
+
+    void prepare(const std::vector<glm::vec3> &positions,
+                 const std::vector<GLfloat> &masses);
+    int subtreeCount() const;
+    void buildSubtree(int bucket);
+    void link();
+
+    // gravitational force on body (same softening as the exact pair sum)
+    glm::vec3 force(int body, GLfloat G, GLfloat eps) const;
+private:
+    static const int Levels = 2;
+    static const int Side = 1 << Levels;
+    static const int MaxDepth = 24;
+
+    struct Node
+    {
+        glm::vec3 center;
+        GLfloat halfSize;
+        glm::vec3 com;
+        GLfloat mass;
+        int first, count; // bodies: order_[first, first+count)
+        std::array<int, 8> children;
+        bool leaf;
+    };
+
+    int buildNode(std::vector<Node> &nodes, int first, int count,
+                  glm::vec3 center, GLfloat halfSize, int depth);
+    int linkNode(int level, glm::ivec3 cell);
+    void accumulate(Node &node, const Node &child) const;
+    glm::vec3 pairForce(const glm::vec3 &v, GLfloat m1, GLfloat m2,
+                        GLfloat G, GLfloat eps) const;
+
+    GLfloat theta_;
+    glm::vec3 center_;
+    GLfloat halfSize_;
+    std::vector<glm::vec3> positions_;
+    std::vector<GLfloat> masses_;
+    std::vector<int> order_;
+    std::array<int, Side*Side*Side + 1> bucketOffsets_;
+    std::array<std::vector<Node>, Side*Side*Side> subtrees_;
+    std::array<int, Side*Side*Side> subtreeRoots_;
+    std::vector<Node> nodes_;
+    int root_;
+};
+
+}
+
+#endif // ENGINE_OCTREE_HPP
@@ -7,461 +7,2222 @@
 #include <chrono>
 #include <cstdio>
 #include <algorithm>
+#include <limits>
+#include <sstream>
 
-GLfloat dist2PointPlane(const glm::vec3 &point, const glm::vec3 &plane, const glm::vec3 &normal);
-GLfloat dist2PointPoint(const glm::vec3 &p1, const glm::vec3 &p2);
-bool pointInFace(const glm::vec3 &point, const glm::vec3 &plane, const glm::vec3 &normal,
-                 const std::array<glm::vec3, 3> &normals, const int n);
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+void setThreadAffinity(std::thread &thread, unsigned int cpu);
+glm::vec3 boxAxis(const Engine::PhysicsModule::Box &box1, const Engine::PhysicsModule::Box &box2, int axis);
+GLfloat boxOverlap(const Engine::PhysicsModule::Box &box1, const Engine::PhysicsModule::Box &box2,
+                   const glm::vec3 &axis);
+int clipPolygon(const glm::vec3 *in, int count, const glm::vec3 &normal, GLfloat offset, glm::vec3 *out);
 
 namespace Engine
 {
 
 PhysicsModule::PhysicsModule(unsigned int tick)
-    : run_{true}, pause_{false},
+    : PhysicsModule(tick, Context{})
+{}
+
+PhysicsModule::PhysicsModule(unsigned int tick, const Context &context)
+    : phase_{nullptr}, contactList_{nullptr}, awakeBodies_{0}, sleepingBodies_{0}, awakeIslands_{0},
+      integrator_{context.integrator}, accelerationsValid_{false},
+      transforms_{std::make_shared<TransformBuffer>()}, tickCount_{0}, context_{context},
+      kernels_(Kernels::select(context.kernels)), run_{true}, workersRun_{false}, pause_{false}, stepRequests_{0}, droppedTicks_{0},
       tick_{(GLfloat)(tick / 1000.0)}, updateInterval_{tick * 1000},
-      threadNum_{1}
+      threadNum_{std::max(1u, context.threadNum)}, inlinePhases_{context.threadNum == 0}
 {}
 
 void PhysicsModule::init()
 {
     master_ = std::make_unique<MasterThread>(shared_from_this());
-    for (unsigned int i=0; i<threadNum_; i++)
+
+    work_.resize(threadNum_);
+    workerEvents_.assign(threadNum_, EventRange{});
+    workersRun_ = true;
+
+    // workers live as long as the module, phases are handed off by barriers
+    // workers wait on phaseBegin_ between ticks too, so spin only briefly there
+    // and park instead of burning the idle part of every tick
+    if (!inlinePhases_)
+    {
+        phaseBegin_.reset(new Barrier(threadNum_ + 1, 256));
+        phaseEnd_.reset(new Barrier(threadNum_ + 1));
+        for (unsigned int i=0; i<threadNum_; i++)
+        {
+            std::unique_ptr<WorkerThread> worker(new WorkerThread(shared_from_this(), i));
+            worker->start();
+            workers_.push_back(std::move(worker));
+        }
+    }
+
+#if defined(PHYSICS_PROFILE)
+    profiler_.start(threadNum_, context_.profileHistory);
+#endif
+}
+
+PhysicsModule::~PhysicsModule()
+{
+    finish();
+}
+
+void PhysicsModule::setScene(std::shared_ptr<Scene::Scene> scene)
+{
+    scene_ = scene;
+    bodies_.clear();
+    for (auto &body : scene_->bodies())
+    {
+        body->setIndex(bodies_.add(body->state()));
+    }
+
+    int n = bodies_.size();
+    restTime_.assign(n, 0);
+    sleepIsland_.assign(n, -1);
+    separatingAxes_.assign(n, std::vector<SeparatingAxis>());
+    awakeBodies_ = sleepingBodies_ = awakeIslands_ = 0;
+    contacts_.clear();
+
+    // a scene may ask for its own integrator
+    integrator_ = context_.integrator;
+    if (!scene_->context().integrator.empty() &&
+        !parseIntegrator(scene_->context().integrator, integrator_))
+    {
+        std::cerr << "[ERROR] Unknown integrator: " << scene_->context().integrator << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    accelerationsValid_ = false;
+    if (integrator_ == Integrator::Events) startEvents();
+
+    tickCount_ = 0;
+    prepareScene();
+}
+
+void PhysicsModule::prepareScene()
+{
+    int n = bodies_.size();
+    workerContacts_.assign(threadNum_, std::vector<ContactStore::Contact>());
+    workerHits_.assign(threadNum_, std::vector<int>(n));
+    workerForces_.resize(threadNum_);
+    for (auto &forces : workerForces_)
+    {
+        forces.fx.assign(n, 0);
+        forces.fy.assign(n, 0);
+        forces.fz.assign(n, 0);
+    }
+
+    updateBoundingBoxes();
+    GLfloat medianRadius = 0;
+    if (n > 0)
+    {
+        std::vector<GLfloat> radii;
+        for (auto &box : boundingBoxes_)
+        {
+            radii.push_back(glm::length(box.max - box.min) / 2);
+        }
+        std::nth_element(radii.begin(), radii.begin() + radii.size() / 2, radii.end());
+        medianRadius = radii[radii.size() / 2];
+    }
+
+    // grid cells about as wide as a typical object
+    GLfloat cellSize = context_.cellSize > 0 ? context_.cellSize : 2 * medianRadius;
+    grid_.setCellSize(cellSize > 0 ? cellSize : 1);
+
+    // static bodies never leave their boxes, so their tree needs no margin
+    dynamicTree_.clear();
+    staticTree_.clear();
+    dynamicTree_.setMargin(context_.treeMargin > 0 ? context_.treeMargin : medianRadius / 10);
+    staticTree_.setMargin(0);
+    treeProxies_.assign(n, -1);
+    neighborsValid_ = false;
+    for (int i=0; i<n; i++)
+    {
+        auto &tree = bodies_.movable(i) ? dynamicTree_ : staticTree_;
+        treeProxies_[i] = tree.insert(boundingBoxes_[i], i);
+    }
+
+    gravityTree_.setTheta(context_.theta);
+    updateBoxes();
+
+    if (!context_.recordFile.empty())
+    {
+        std::vector<glm::vec3> scales;
+        for (auto &body : scene_->bodies())
+        {
+            scales.push_back(body->state().radius);
+        }
+        if (!recorder_.open(context_.recordFile, scales, tick_)) exit(EXIT_FAILURE);
+    }
+
+    // initial state, so render has something to draw before the first tick
+    transforms_->resize(n);
+    publishTransforms();
+}
+
+bool PhysicsModule::saveCheckpoint(const std::string &path)
+{
+    if (!scene_)
+    {
+        std::cerr << "[ERROR] No scene to checkpoint" << std::endl;
+        return false;
+    }
+
+    auto &sceneContext = scene_->context();
+    auto &bodies = scene_->bodies();
+    auto &appearances = scene_->appearances();
+    CheckpointState state;
+    state.scalars = CheckpointState::Scalars{tickCount_, (std::int32_t)integrator_, accelerationsValid_,
+                                             awakeBodies_, sleepingBodies_, awakeIslands_,
+                                             updateInterval_, sceneContext.G, sceneContext.g};
+    state.sceneIntegrator = sceneContext.integrator;
+    for (std::size_t i=0; i<bodies.size(); i++)
+    {
+        state.states.push_back(bodies[i]->state());
+        state.appearances += appearances[i].model + '\n' + appearances[i].texture + '\n';
+    }
+    state.axisOffsets.push_back(0);
+    for (auto &axes : separatingAxes_)
+    {
+        state.axes.insert(state.axes.end(), axes.begin(), axes.end());
+        state.axisOffsets.push_back((int)state.axes.size());
+    }
+
+    Checkpoint checkpoint;
+    if (!checkpoint.create(path)) return false;
+    checkpointParts(checkpoint, state);
+    return checkpoint.commit();
+}
+
+bool PhysicsModule::restoreCheckpoint(const std::string &path)
+{
+    // the stores are read into directly, each array sized from the header
+    CheckpointState state;
+    Checkpoint checkpoint;
+    bool restored = checkpoint.open(path);
+    if (restored)
+    {
+        checkpointParts(checkpoint, state);
+        restored = checkpoint.commit();
+    }
+    if (restored && !checkpointConsistent(state))
+    {
+        std::cerr << "[ERROR] Checkpoint contradicts itself: " << path << std::endl;
+        restored = false;
+    }
+    if (!restored)
+    {
+        scene_.reset();
+        bodies_.clear();
+        contacts_.clear();
+        return false;
+    }
+
+    // the scene is rebuilt from the states it had, so its bodies match to the bit
+    Scene::Scene::Context sceneContext;
+    sceneContext.G = state.scalars.G;
+    sceneContext.g = state.scalars.g;
+    sceneContext.integrator = state.sceneIntegrator;
+    auto scene = std::make_shared<Scene::Scene>(sceneContext);
+    std::istringstream appearances(state.appearances);
+    for (std::size_t i=0; i<state.states.size(); i++)
+    {
+        Scene::Scene::Appearance appearance;
+        std::getline(appearances, appearance.model);
+        std::getline(appearances, appearance.texture);
+        scene->addBody(state.states[i], appearance);
+        scene->bodies().back()->setIndex((int)i);
+    }
+    scene_ = scene;
+
+    separatingAxes_.resize(state.states.size());
+    for (std::size_t i=0; i<separatingAxes_.size(); i++)
+    {
+        separatingAxes_[i].assign(state.axes.begin() + state.axisOffsets[i],
+                                  state.axes.begin() + state.axisOffsets[i + 1]);
+    }
+    integrator_ = (Integrator)state.scalars.integrator;
+    accelerationsValid_ = state.scalars.accelerationsValid != 0;
+    awakeBodies_ = state.scalars.awake;
+    sleepingBodies_ = state.scalars.sleeping;
+    awakeIslands_ = state.scalars.islands;
+    tickCount_ = (unsigned long)state.scalars.tickCount;
+    if (state.scalars.tick != updateInterval_)
+    {
+        std::cerr << "[WARNING] Checkpoint was simulated with " << state.scalars.tick / 1000
+                  << " ms ticks, going on with " << updateInterval_ / 1000 << " ms" << std::endl;
+    }
+
+    // grid, trees, neighbour lists and boxes are rebuilt, not stored
+    prepareScene();
+    return true;
+}
+
+std::shared_ptr<Scene::Scene> PhysicsModule::scene() const
+{
+    return scene_;
+}
+
+unsigned long PhysicsModule::ticks() const
+{
+    return tickCount_;
+}
+
+void PhysicsModule::checkpointParts(Checkpoint &checkpoint, CheckpointState &state)
+{
+    // this order is the file layout, bump Checkpoint::Version when it changes
+    checkpoint.value(state.scalars);
+    checkpoint.text(state.sceneIntegrator);
+    checkpoint.text(state.appearances);
+    checkpoint.part(state.states);
+
+    for (auto *values : {&bodies_.px, &bodies_.py, &bodies_.pz, &bodies_.vx, &bodies_.vy, &bodies_.vz,
+                         &bodies_.ax, &bodies_.ay, &bodies_.az, &bodies_.mass,
+                         &bodies_.rx, &bodies_.ry, &bodies_.rz, &bodies_.bound})
+    {
+        checkpoint.part(*values);
+    }
+    for (auto &axes : bodies_.axes)
+    {
+        checkpoint.part(axes);
+    }
+    checkpoint.part(bodies_.types);
+    checkpoint.part(bodies_.flags);
+
+    contacts_.checkpoint(checkpoint);
+    checkpoint.part(restTime_);
+    checkpoint.part(sleepIsland_);
+    checkpoint.part(state.axisOffsets);
+    checkpoint.part(state.axes);
+    hardSpheres_.checkpoint(checkpoint);
+}
+
+bool PhysicsModule::checkpointConsistent(const CheckpointState &state)
+{
+    std::size_t n = state.states.size();
+    for (auto *values : {&bodies_.px, &bodies_.py, &bodies_.pz, &bodies_.vx, &bodies_.vy, &bodies_.vz,
+                         &bodies_.ax, &bodies_.ay, &bodies_.az, &bodies_.mass,
+                         &bodies_.rx, &bodies_.ry, &bodies_.rz, &bodies_.bound})
+    {
+        if (values->size() != n) return false;
+    }
+    for (auto &axes : bodies_.axes)
+    {
+        if (axes.size() != n) return false;
+    }
+    if (bodies_.types.size() != n || bodies_.flags.size() != n ||
+        restTime_.size() != n || sleepIsland_.size() != n)
+    {
+        return false;
+    }
+    if (std::count(state.appearances.begin(), state.appearances.end(), '\n') != (std::ptrdiff_t)(2 * n))
+    {
+        return false;
+    }
+
+    if (state.axisOffsets.size() != n + 1 || state.axisOffsets[0] != 0 ||
+        state.axisOffsets[n] != (int)state.axes.size() ||
+        !std::is_sorted(state.axisOffsets.begin(), state.axisOffsets.end()))
+    {
+        return false;
+    }
+
+    if (!contacts_.consistent()) return false;
+    for (auto &contact : contacts_.contacts())
+    {
+        if (contact.body1 < 0 || contact.body2 >= (int)n || contact.body1 >= contact.body2) return false;
+    }
+
+    auto integrator = state.scalars.integrator;
+    if (integrator < Integrator::SemiImplicitEuler || integrator > Integrator::Events) return false;
+    return integrator != Integrator::Events || hardSpheres_.consistent((int)n);
+}
+
+void PhysicsModule::start()
+{
+    master_->run(&PhysicsModule::simulate);
+}
+
+void PhysicsModule::pause()
+{
+    std::lock_guard<std::mutex> lock(pauseMutex_);
+    pause_ = true;
+}
+
+void PhysicsModule::resume()
+{
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        pause_ = false;
+        stepRequests_ = 0;
+    }
+    pauseCond_.notify_all();
+}
+
+bool PhysicsModule::paused()
+{
+    std::lock_guard<std::mutex> lock(pauseMutex_);
+    return pause_;
+}
+
+void PhysicsModule::step(unsigned int ticks)
+{
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        pause_ = true;
+        stepRequests_ += ticks;
+    }
+    pauseCond_.notify_all();
+}
+
+unsigned long PhysicsModule::droppedTicks() const
+{
+    return droppedTicks_;
+}
+
+std::shared_ptr<TransformBuffer> PhysicsModule::transforms()
+{
+    return transforms_;
+}
+
+PhysicsModule::Stats PhysicsModule::stats() const
+{
+    return Stats{awakeBodies_, sleepingBodies_, awakeIslands_};
+}
+
+void PhysicsModule::setIntegrator(Integrator integrator)
+{
+    integrator_ = integrator;
+    accelerationsValid_ = false;
+    if (integrator_ == Integrator::Events) startEvents();
+}
+
+bool PhysicsModule::parseIntegrator(const std::string &name, Integrator &integrator)
+{
+    if (name == "euler") integrator = Integrator::SemiImplicitEuler;
+    else if (name == "verlet" || name == "leapfrog") integrator = Integrator::Verlet;
+    else if (name == "rk4") integrator = Integrator::RK4;
+    else if (name == "events") integrator = Integrator::Events;
+    else return false;
+    return true;
+}
+
+bool PhysicsModule::testPair(int body1, int body2, ContactStore::Contact &contact)
+{
+    // only while no tick is running, box data is that of the last evaluation
+    return testCollision(body1, body2, contact);
+}
+
+void PhysicsModule::advance(unsigned int ticks)
+{
+    // nothing happens between collisions, so the ticks are one jump
+    if (integrator_ == Integrator::Events)
+    {
+        simulationUpdate(ticks);
+        return;
+    }
+    for (unsigned int i=0; i<ticks; i++)
+    {
+        simulationUpdate();
+    }
+}
+
+void PhysicsModule::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        run_ = false;
+    }
+    pauseCond_.notify_all(); // wake the master if it is parked
+    if (master_) master_->join(); // not started when driven by advance()
+    recorder_.close();
+
+    if (workersRun_)
+    {
+        workersRun_ = false;
+        if (!inlinePhases_)
+        {
+            phaseBegin_->wait(); // release workers so they can see the stop flag
+            workersJoin();
+        }
+
+#if defined(PHYSICS_PROFILE)
+        profiler_.stop();
+        if (!context_.profileCsv.empty()) profiler_.writeCsv(context_.profileCsv);
+        if (!context_.profileTrace.empty()) profiler_.writeTrace(context_.profileTrace);
+        if (profiler_.dropped() > 0)
+        {
+            std::cerr << "[WARNING] Profiler dropped " << profiler_.dropped() << " ticks" << std::endl;
+        }
+#endif
+    }
+}
+
+void PhysicsModule::runPhase(Phase phase) // run by master
+{
+    runPhase(phase, bodies_.size());
+}
+
+void PhysicsModule::runPhase(Phase phase, int count) // run by master
+{
+    auto cost = std::find_if(phaseCosts_.begin(), phaseCosts_.end(),
+                             [phase](const PhaseCost &c) { return c.phase == phase; });
+    if (cost == phaseCosts_.end())
+    {
+        phaseCosts_.push_back(PhaseCost{phase, 0});
+        cost = phaseCosts_.end() - 1;
+    }
+
+    // events [0, count) are split across the workers, see WorkQueue
+    int grain = context_.grainSize > 0 ? (int)context_.grainSize : grainSize(*cost, count);
+    work_.reset(count, grain);
+    for (auto &events : workerEvents_)
+    {
+        events.next = events.end = 0;
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    phase_ = phase;
+    if (inlinePhases_)
+    {
+        PROFILE_WORKER(profiler_, 0);
+        (this->*phase)(0);
+    }
+    else
+    {
+        phaseBegin_->wait();
+        phaseEnd_->wait();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    if (count > 0)
+    {
+        std::chrono::duration<double, std::nano> elapsed = t2 - t1;
+        double sample = elapsed.count() * threadNum_ / count;
+        cost->cost = cost->cost > 0 ? 0.8 * cost->cost + 0.2 * sample : sample;
+    }
+}
+
+int PhysicsModule::grainSize(PhaseCost &cost, int count)
+{
+    // chunks of about 20us touch the shared ranges rarely, while leaving
+    // every worker a few of them so stealing can still balance the load
+    const double target = 20000;
+    int limit = std::max(1, count / (int)(threadNum_ * 4));
+    if (cost.cost <= 0) return limit;
+    return std::max(1, std::min(limit, (int)(target / cost.cost)));
+}
+
+void PhysicsModule::workersJoin()
+{
+    for (auto &worker : workers_) {
+        if (!worker->join())
+        {
+            std::cerr << "Worker thread isn't joinable." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int PhysicsModule::getEvent(unsigned int worker)
+{
+    auto &events = workerEvents_[worker];
+    if (events.next == events.end)
+    {
+        bool stolen;
+        if (!work_.pop(worker, events.next, events.end, stolen)) return -1;
+        PROFILE_COUNT(profiler_, worker, events, events.end - events.next);
+        PROFILE_COUNT(profiler_, worker, steals, stolen);
+    }
+    return events.next++;
+}
+
+void PhysicsModule::simulate()
+{
+    typedef std::chrono::steady_clock Clock;
+    const std::chrono::microseconds interval(updateInterval_);
+    const std::chrono::microseconds spinMargin(context_.spinMargin);
+    const unsigned int maxSubSteps = std::max(1u, context_.maxSubSteps);
+
+    Clock::time_point next = Clock::now(); // deadline of the next tick
+
+    while (run_)
+    {
+        {
+            std::unique_lock<std::mutex> lock(pauseMutex_);
+            if (pause_)
+            {
+                // park until resumed, asked to step or finished
+                pauseCond_.wait(lock, [this] { return !pause_ || stepRequests_ > 0 || !run_; });
+                if (!run_) break;
+                if (pause_)
+                {
+                    stepRequests_--;
+                    lock.unlock();
+                    simulationUpdate();
+                    continue;
+                }
+                next = Clock::now(); // time spent paused is not caught up
+            }
+        }
+
+        // sleep until close to the deadline, spin the rest for precision
+        if (Clock::now() < next - spinMargin)
+        {
+            std::this_thread::sleep_until(next - spinMargin);
+        }
+        while (Clock::now() < next);
+
+        // run every tick that is due, at most maxSubSteps in a row
+        unsigned int steps = 0;
+        do
+        {
+            simulationUpdate();
+            next += interval;
+            steps++;
+        } while (steps < maxSubSteps && Clock::now() >= next && run_);
+
+        // too far behind, drop the backlog instead of spiraling
+        Clock::time_point now = Clock::now();
+        if (now >= next)
+        {
+            auto behind = std::chrono::duration_cast<std::chrono::microseconds>(now - next);
+            droppedTicks_ += behind / interval + 1;
+            next += (behind / interval + 1) * interval;
+        }
+    }
+}
+
+void PhysicsModule::simulationUpdate(unsigned int ticks) // run by master
+{
+    if (!scene_)
+    {
+        std::cerr << "Scene is null while simulation is running" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (bodies_.size() != (int)scene_->bodies().size())
+    {
+        std::cerr << "Size of scene and body store mismatch" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    PROFILE_TICK_BEGIN(profiler_, tickCount_ + 1);
+
+    if (context_.sweepFraction > 0 && integrator_ != Integrator::Events)
+    {
+        sweepStarts_.resize(bodies_.size());
+        for (int i=0; i<bodies_.size(); i++)
+        {
+            sweepStarts_[i] = bodies_.position(i);
+        }
+    }
+
+    switch (integrator_)
+    {
+        case Integrator::SemiImplicitEuler: integrateSemiImplicitEuler(); break;
+        case Integrator::Verlet: integrateVerlet(); break;
+        case Integrator::RK4: integrateRK4(); break;
+        case Integrator::Events: integrateEvents(ticks); break;
+    }
+
+    // whatever moved too far to trust the overlap tests is swept back
+    if (integrator_ != Integrator::Events) sweepFastBodies();
+
+    // hand the new states to the scene bodies
+    {
+        PROFILE_PHASE(profiler_, Publish);
+        for (auto &body : scene_->bodies())
+        {
+            int index = body->index();
+            body->displace(bodies_.position(index) - body->state().centroid);
+            body->accelerate(bodies_.velocity(index) - body->state().velocity);
+        }
+
+        tickCount_ += ticks;
+        publishTransforms();
+    }
+
+    PROFILE_TICK_END(profiler_);
+}
+
+void PhysicsModule::evaluateForces(bool stage) // run by master
+{
+    // stage: intermediate RK4 state or Verlet's first a(x), its contacts are
+    // used but not kept, so contact ages and rest times move once per tick
+
+    // collision test
+    {
+        PROFILE_PHASE(profiler_, BroadPhase);
+        updateBoxes();
+        updateBroadPhase();
+    }
+    {
+        PROFILE_PHASE(profiler_, NarrowPhase);
+        runPhase(&PhysicsModule::updateCollisionStates);
+    }
+    {
+        PROFILE_PHASE(profiler_, Contacts);
+        if (stage)
+        {
+            updateStageContacts();
+        }
+        else
+        {
+            updateContacts();
+            updateIslands();
+        }
+    }
+
+    // forces, each pair once, then sum the per worker forces
+    {
+        PROFILE_PHASE(profiler_, GravityTree);
+        updateGravityTree();
+        updateGravitySources();
+    }
+    {
+        PROFILE_PHASE(profiler_, Forces);
+        runPhase(&PhysicsModule::updateForces);
+        runPhase(&PhysicsModule::updateAccelerations);
+    }
+}
+
+void PhysicsModule::integrateSemiImplicitEuler() // run by master
+{
+    evaluateForces(false);
+
+    int n = bodies_.size();
+    GLfloat *px = bodies_.px.data(), *py = bodies_.py.data(), *pz = bodies_.pz.data();
+    GLfloat *vx = bodies_.vx.data(), *vy = bodies_.vy.data(), *vz = bodies_.vz.data();
+    const GLfloat *ax = bodies_.ax.data(), *ay = bodies_.ay.data(), *az = bodies_.az.data();
+    {
+        PROFILE_PHASE(profiler_, Integration);
+        for (int i=0; i<n; i++)
+        {
+            vx[i] += ax[i] * tick_;
+            vy[i] += ay[i] * tick_;
+            vz[i] += az[i] * tick_;
+        }
+    }
+
+    // contacts correct the new velocities before they move anything
+    solveContacts();
+
+    PROFILE_PHASE(profiler_, Integration);
+    for (int i=0; i<n; i++)
+    {
+        px[i] += vx[i] * tick_;
+        py[i] += vy[i] * tick_;
+        pz[i] += vz[i] * tick_;
+    }
+}
+
+void PhysicsModule::integrateVerlet() // run by master
+{
+    // kick with a(x) of the last tick, drift, then kick with the new a(x)
+    if (!accelerationsValid_) evaluateForces(true);
+
+    int n = bodies_.size();
+    GLfloat *px = bodies_.px.data(), *py = bodies_.py.data(), *pz = bodies_.pz.data();
+    GLfloat *vx = bodies_.vx.data(), *vy = bodies_.vy.data(), *vz = bodies_.vz.data();
+    const GLfloat *ax = bodies_.ax.data(), *ay = bodies_.ay.data(), *az = bodies_.az.data();
+    const GLfloat half = tick_ / 2;
+    {
+        PROFILE_PHASE(profiler_, Integration);
+        for (int i=0; i<n; i++)
+        {
+            vx[i] += ax[i] * half;
+            vy[i] += ay[i] * half;
+            vz[i] += az[i] * half;
+            px[i] += vx[i] * tick_;
+            py[i] += vy[i] * tick_;
+            pz[i] += vz[i] * tick_;
+        }
+    }
+
+    evaluateForces(false);
+    accelerationsValid_ = true;
+
+    {
+        PROFILE_PHASE(profiler_, Integration);
+        for (int i=0; i<n; i++)
+        {
+            vx[i] += ax[i] * half;
+            vy[i] += ay[i] * half;
+            vz[i] += az[i] * half;
+        }
+    }
+
+    // contacts of the new positions, the next drift moves with the result
+    solveContacts();
+}
+
+void PhysicsModule::integrateEvents(unsigned int ticks) // run by master
+{
+    PROFILE_PHASE(profiler_, Integration);
+    hardSpheres_.advance((double)tick_ * ticks);
+    hardSpheres_.store(bodies_);
+}
+
+void PhysicsModule::startEvents()
+{
+    // from the current state, so it can take over from any integrator
+    if (!hardSpheres_.reset(bodies_))
+    {
+        std::cerr << "[ERROR] Event-driven simulation needs every movable body to be a sphere" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    awakeBodies_ = sleepingBodies_ = awakeIslands_ = 0;
+    for (int i=0; i<bodies_.size(); i++)
+    {
+        bodies_.setSleeping(i, false);
+        if (bodies_.movable(i)) awakeBodies_++;
+    }
+}
+
+void PhysicsModule::integrateRK4() // run by master
+{
+    int n = bodies_.size();
+    startPositions_.resize(n);
+    startVelocities_.resize(n);
+    sumVelocities_.resize(n);
+    sumAccelerations_.resize(n);
+    for (int i=0; i<n; i++)
+    {
+        startPositions_[i] = bodies_.position(i);
+        startVelocities_[i] = bodies_.velocity(i);
+    }
+
+    // stage k is evaluated at the state left by stage k-1, weights 1 2 2 1
+    const GLfloat steps[4] = {tick_ / 2, tick_ / 2, tick_, 0};
+    const GLfloat weights[4] = {1, 2, 2, 1};
+    for (int k=0; k<4; k++)
+    {
+        evaluateForces(k > 0);
+
+        PROFILE_PHASE(profiler_, Integration);
+        for (int i=0; i<n; i++)
+        {
+            glm::vec3 v = bodies_.velocity(i);
+            glm::vec3 a(bodies_.ax[i], bodies_.ay[i], bodies_.az[i]);
+            sumVelocities_[i] = k == 0 ? v : sumVelocities_[i] + weights[k] * v;
+            sumAccelerations_[i] = k == 0 ? a : sumAccelerations_[i] + weights[k] * a;
+            if (k < 3)
+            {
+                bodies_.setPosition(i, startPositions_[i] + v * steps[k]);
+                bodies_.setVelocity(i, startVelocities_[i] + a * steps[k]);
+            }
+        }
+    }
+
+    {
+        PROFILE_PHASE(profiler_, Integration);
+        for (int i=0; i<n; i++)
+        {
+            bodies_.setPosition(i, startPositions_[i] + sumVelocities_[i] * (tick_ / 6));
+            // bodies put to sleep during the tick stay at rest
+            bodies_.setVelocity(i, bodies_.sleeping(i) ? glm::vec3(0) :
+                                   startVelocities_[i] + sumAccelerations_[i] * (tick_ / 6));
+        }
+    }
+
+    // impulses only act on the final velocities, with the contacts found at
+    // the start of the tick; the overlap left is pushed out next tick
+    solveContacts();
+}
+
+void PhysicsModule::publishTransforms() // run by master
+{
+    // render reads these instead of the bodies, which only physics touches
+    TransformBuffer::Frame &frame = transforms_->back();
+    auto &bodies = scene_->bodies();
+    frame.tick = tickCount_;
+    frame.time = TransformBuffer::Clock::now();
+    frame.models.resize(bodies.size());
+    for (std::size_t i=0; i<bodies.size(); i++)
+    {
+        frame.models[i] = bodies[i]->model();
+    }
+    transforms_->publish();
+    recorder_.append(tickCount_, bodies_);
+}
+
+void PhysicsModule::updateBoxes() // run by master
+{
+    // box frames of this state, so the pair tests don't redo them per pair
+    int n = bodies_.size();
+    boxes_.resize(n);
+    for (int i=0; i<n; i++)
+    {
+        if (bodies_.type(i) == Scene::Body::Type::Cube) boxes_[i] = getBox(i);
+    }
+}
+
+void PhysicsModule::updateBroadPhase() // run by master
+{
+    if (context_.broadPhase == BroadPhase::BruteForce) return;
+
+    // neighbour lists: pairs are found with boxes grown by half the skin on
+    // every side, no other pair can touch before a body moves that far
+    GLfloat skin = context_.neighborSkin;
+    if (skin > 0)
+    {
+        if (neighborsValid_ && !neighborsMoved(skin / 2)) return;
+        neighborsValid_ = true;
+        neighborOrigins_.resize(bodies_.size());
+        for (int i=0; i<bodies_.size(); i++)
+        {
+            neighborOrigins_[i] = bodies_.position(i);
+        }
+    }
+
+    updateBoundingBoxes();
+    if (skin > 0)
+    {
+        for (auto &box : boundingBoxes_)
+        {
+            box.min -= skin / 2;
+            box.max += skin / 2;
+        }
+    }
+    if (context_.broadPhase == BroadPhase::SpatialHash)
+    {
+        grid_.build(boundingBoxes_);
+        buildCandidates(grid_.pairs());
+        return;
+    }
+
+    // awake bodies look for movable ones in the dynamic tree and for static
+    // ones in the static tree; a pair of awake bodies is met from both sides
+    // and kept by the lower one. Pairs without an awake body are never
+    // tested, so nothing else has to look, unless the lists outlive the tick
+    // and sleeping bodies may wake up meanwhile
+    auto looks = [&](int i) { return skin > 0 ? bodies_.movable(i) : bodies_.active(i); };
+    updateTrees();
+    treePairs_.clear();
+    for (int i=0; i<bodies_.size(); i++)
+    {
+        if (!looks(i)) continue;
+        const Aabb &box = boundingBoxes_[i];
+        dynamicTree_.query(box, [&](int j)
+        {
+            if ((j > i || !looks(j)) && j != i && overlap(box, boundingBoxes_[j]))
+            {
+                treePairs_.push_back(std::minmax(i, j));
+            }
+            return true;
+        });
+        staticTree_.query(box, [&](int j)
+        {
+            if (overlap(box, boundingBoxes_[j])) treePairs_.push_back(std::minmax(i, j));
+            return true;
+        });
+    }
+    std::sort(treePairs_.begin(), treePairs_.end());
+    buildCandidates(treePairs_);
+}
+
+void PhysicsModule::updateBoundingBoxes()
+{
+    int n = bodies_.size();
+    boundingBoxes_.resize(n);
+    for (int i=0; i<n; i++)
+    {
+        boundingBoxes_[i] = getBoundingBox(i);
+    }
+}
+
+void PhysicsModule::updateTrees()
+{
+    // bodies still inside their fat boxes cost one comparison, the ones
+    // leaving get fat boxes covering the next two ticks at their velocity
+    for (int i=0; i<bodies_.size(); i++)
+    {
+        if (!bodies_.movable(i)) continue;
+        dynamicTree_.move(treeProxies_[i], boundingBoxes_[i], bodies_.velocity(i) * (2 * tick_));
+    }
+}
+
+bool PhysicsModule::neighborsMoved(GLfloat distance)
+{
+    const GLfloat *px = bodies_.px.data(), *py = bodies_.py.data(), *pz = bodies_.pz.data();
+    for (int i=0; i<bodies_.size(); i++)
+    {
+        glm::vec3 d = glm::vec3(px[i], py[i], pz[i]) - neighborOrigins_[i];
+        if (glm::dot(d, d) > distance * distance) return true;
+    }
+    return false;
+}
+
+void PhysicsModule::buildCandidates(const std::vector<SpatialHashGrid::Pair> &pairs)
+{
+    // candidate pairs (i < j) -> candidate lists of i
+    int n = bodies_.size();
+    candidateOffsets_.assign(n + 1, 0);
+    for (auto &pair : pairs)
+    {
+        candidateOffsets_[pair.first + 1]++;
+    }
+    for (int i=0; i<n; i++)
+    {
+        candidateOffsets_[i + 1] += candidateOffsets_[i];
+    }
+    candidates_.resize(candidateOffsets_.back());
+    std::vector<int> fill(candidateOffsets_.begin(), candidateOffsets_.end() - 1);
+    for (auto &pair : pairs)
+    {
+        candidates_[fill[pair.first]++] = pair.second;
+    }
+}
+
+bool PhysicsModule::raycast(const glm::vec3 &origin, const glm::vec3 &direction, GLfloat maxDistance,
+                            RayHit &hit)
+{
+    if (glm::dot(direction, direction) <= 0) return false;
+    glm::vec3 unit = glm::normalize(direction);
+    updateBoxes();
+    updateBoundingBoxes();
+    updateTrees();
+
+    // the trees give every body whose box the ray crosses, nearest first;
+    // the exact test clips the ray so farther subtrees are skipped
+    bool found = false;
+    auto visit = [&](int body, GLfloat distance)
+    {
+        RayHit candidate;
+        if (raycastBody(body, origin, unit, candidate) && candidate.distance <= distance)
+        {
+            hit = candidate;
+            found = true;
+            return candidate.distance;
+        }
+        return distance;
+    };
+    dynamicTree_.raycast(origin, unit, maxDistance, visit);
+    staticTree_.raycast(origin, unit, found ? hit.distance : maxDistance, visit);
+    return found;
+}
+
+void PhysicsModule::queryRegion(const Aabb &region, std::vector<int> &bodies)
+{
+    updateBoundingBoxes();
+    updateTrees();
+
+    bodies.clear();
+    auto visit = [&](int body)
+    {
+        if (overlap(region, boundingBoxes_[body])) bodies.push_back(body);
+        return true;
+    };
+    dynamicTree_.query(region, visit);
+    staticTree_.query(region, visit);
+    std::sort(bodies.begin(), bodies.end());
+}
+
+PhysicsModule::GravityReport PhysicsModule::gravityReport()
+{
+    updateGravityTree();
+    updateGravitySources();
+
+    int n = bodies_.size();
+    double G = scene_->context().G;
+    GravityReport report{context_.gravity == Gravity::Attractors ? (int)gravitySources_.size() : n, 0, 0};
+    int compared = 0;
+    for (int i=0; i<n; i++)
+    {
+        if (!bodies_.movable(i)) continue;
+
+        // reference in double, every other body pulls
+        glm::dvec3 exact(0);
+        glm::dvec3 p(bodies_.position(i));
+        double e = (double)eps;
+        for (int j=0; j<n; j++)
+        {
+            if (j == i) continue;
+            glm::dvec3 d = glm::dvec3(bodies_.position(j)) - p;
+            double r = glm::length(d);
+            exact += d * (G * (double)bodies_.mass[i] * (double)bodies_.mass[j] / ((r*r + e) * (r + e)));
+        }
+
+        glm::vec3 F(0);
+        if (context_.gravity == Gravity::BarnesHut) F = gravityTree_.force(i, (GLfloat)G, eps);
+        else if (context_.gravity == Gravity::Attractors) F = getSourceGravity(i);
+        else
+        {
+            for (int j=0; j<n; j++)
+            {
+                if (j != i) F += getGravity(i, j);
+            }
+        }
+
+        double magnitude = glm::length(exact);
+        if (magnitude <= 0) continue;
+        double error = glm::length(glm::dvec3(F) - exact) / magnitude;
+        report.maxError = std::max(report.maxError, error);
+        report.meanError += error;
+        compared++;
+    }
+    if (compared > 0) report.meanError /= compared;
+    return report;
+}
+
+void PhysicsModule::updateGravityTree() // run by master
+{
+    if (context_.gravity != Gravity::BarnesHut) return;
+
+    int n = bodies_.size();
+    gravityPositions_.resize(n);
+    gravityMasses_.assign(bodies_.mass.begin(), bodies_.mass.end());
+    for (int i=0; i<n; i++)
+    {
+        gravityPositions_[i] = bodies_.position(i);
+    }
+
+    // workers build one subtree per event, the master links them
+    gravityTree_.prepare(gravityPositions_, gravityMasses_);
+    runPhase(&PhysicsModule::buildGravitySubtrees, gravityTree_.subtreeCount());
+    gravityTree_.link();
+}
+
+void PhysicsModule::updateGravitySources() // run by master
+{
+    if (context_.gravity != Gravity::Attractors) return;
+
+    // O(N) next to the O(N S) sum, so it is simply redone every evaluation
+    // and a changed mass moves a body between sources and test particles
+    // right away
+    int n = bodies_.size();
+    GLfloat heaviest = 0;
+    for (int i=0; i<n; i++)
+    {
+        heaviest = std::max(heaviest, bodies_.mass[i]);
+    }
+    GLfloat threshold = context_.sourceRatio * heaviest;
+    gravitySources_.clear();
+    gravitySource_.resize(n);
+    for (int i=0; i<n; i++)
+    {
+        gravitySource_[i] = bodies_.mass[i] > 0 && bodies_.mass[i] >= threshold;
+        if (gravitySource_[i]) gravitySources_.push_back(i);
+    }
+}
+
+void PhysicsModule::buildGravitySubtrees(unsigned int worker)
+{
+    while (true)
+    {
+        int event = getEvent(worker);
+        if (event == -1)
+            break;
+
+        gravityTree_.buildSubtree(event);
+    }
+}
+
+void PhysicsModule::updateForces(unsigned int worker)
+{
+    auto &forces = workerForces_[worker];
+    while (true)
+    {
+        int event = getEvent(worker);
+        if (event == -1)
+            break;
+
+        // sleeping and static bodies only pass on what they do to awake ones
+        applyGravity(event, forces);
+        if (context_.contactModel == ContactModel::Penalty) applyCollisionForces(event, forces);
+    }
+}
+
+void PhysicsModule::updateAccelerations(unsigned int worker)
+{
+    while (true)
+    {
+        int event = getEvent(worker);
+        if (event == -1)
+            break;
+
+        // sum of forces
+        glm::vec3 F{0};
+        for (auto &forces : workerForces_)
+        {
+            F += glm::vec3(forces.fx[event], forces.fy[event], forces.fz[event]);
+            forces.fx[event] = forces.fy[event] = forces.fz[event] = 0;
+        }
+
+        // only this body's slot is written, the integrator applies it
+        glm::vec3 a = bodies_.active(event) ? getAcceleration(event, F) : glm::vec3(0);
+        bodies_.ax[event] = a.x;
+        bodies_.ay[event] = a.y;
+        bodies_.az[event] = a.z;
+    }
+}
+
+Aabb PhysicsModule::getBoundingBox(int body)
+{
+    glm::vec3 centroid = bodies_.position(body);
+    glm::vec3 extent;
+    if (bodies_.type(body) == Scene::Body::Type::Sphere)
+    {
+        extent = glm::vec3(bodies_.rx[body]);
+    }
+    else
+    {
+        // half extents of an oriented box projected on the world axes
+        extent = glm::abs(bodies_.axes[0][body]) +
+                 glm::abs(bodies_.axes[1][body]) +
+                 glm::abs(bodies_.axes[2][body]);
+    }
+    return Aabb{centroid - extent, centroid + extent};
+}
+
+Aabb PhysicsModule::getSweptBox(int body)
+{
+    // bodies never rotate, so the box only moves along
+    Aabb box = getBoundingBox(body);
+    glm::vec3 back = sweepStarts_[body] - bodies_.position(body);
+    box.min += glm::min(back, glm::vec3(0));
+    box.max += glm::max(back, glm::vec3(0));
+    return box;
+}
+
+bool PhysicsModule::raycastBody(int body, const glm::vec3 &origin, const glm::vec3 &direction,
+                                RayHit &hit)
+{
+    // direction is normalized
+    glm::vec3 center = bodies_.position(body);
+    hit.body = body;
+    if (bodies_.type(body) == Scene::Body::Type::Sphere)
+    {
+        GLfloat r = bodies_.rx[body];
+        glm::vec3 offset = origin - center;
+        GLfloat c = glm::dot(offset, offset) - r * r;
+        if (c <= 0)
+        {
+            hit.distance = 0;
+            hit.point = origin;
+            hit.normal = -direction;
+            return true;
+        }
+        GLfloat b = glm::dot(offset, direction);
+        GLfloat discriminant = b * b - c;
+        if (b > 0 || discriminant < 0) return false;
+        hit.distance = -b - std::sqrt(discriminant);
+        hit.point = origin + direction * hit.distance;
+        hit.normal = (hit.point - center) / r;
+        return true;
+    }
+
+    // slabs of the box in its own frame
+    const Box &box = boxes_[body];
+    glm::vec3 offset = origin - box.center;
+    GLfloat enter = -std::numeric_limits<GLfloat>::max(), exit = std::numeric_limits<GLfloat>::max();
+    glm::vec3 normal = -direction;
+    for (int k=0; k<3; k++)
+    {
+        GLfloat o = glm::dot(offset, box.axes[k]);
+        GLfloat d = glm::dot(direction, box.axes[k]);
+        if (std::abs(d) < eps)
+        {
+            if (std::abs(o) > box.half[k]) return false;
+            continue;
+        }
+        GLfloat t1 = (-box.half[k] - o) / d, t2 = (box.half[k] - o) / d;
+        if (t1 > t2) std::swap(t1, t2);
+        if (t1 > enter)
+        {
+            enter = t1;
+            normal = box.axes[k] * (d > 0 ? -1.0f : 1.0f);
+        }
+        exit = std::min(exit, t2);
+    }
+    if (enter > exit || exit < 0) return false;
+
+    if (enter < 0)
+    {
+        hit.distance = 0;
+        hit.normal = -direction;
+    }
+    else
+    {
+        hit.distance = enter;
+        hit.normal = normal;
+    }
+    hit.point = origin + direction * hit.distance;
+    return true;
+}
+
+void PhysicsModule::applyGravity(int body, ForceAccumulator &forces)
+{
+    GLfloat G = scene_->context().G;
+    GLfloat *fx = forces.fx.data(), *fy = forces.fy.data(), *fz = forces.fz.data();
+    if (context_.gravity == Gravity::BarnesHut)
+    {
+        if (!bodies_.active(body)) return; // the tree still holds its mass
+        glm::vec3 F = gravityTree_.force(body, G, eps);
+        fx[body] += F.x;
+        fy[body] += F.y;
+        fz[body] += F.z;
+    }
+    else if (context_.gravity == Gravity::Attractors)
+    {
+        if (!bodies_.active(body)) return; // sources pull whether awake or not
+        glm::vec3 F = getSourceGravity(body);
+        fx[body] += F.x;
+        fy[body] += F.y;
+        fz[body] += F.z;
+    }
+    else
     {
-        std::unique_ptr<WorkerThread> worker(new WorkerThread(shared_from_this()));
-        workers_.push_back(std::move(worker));
+        // pairs (body, t > body), t gets the opposite force
+        const GLfloat *px = bodies_.px.data(), *py = bodies_.py.data(), *pz = bodies_.pz.data();
+        const GLfloat *mass = bodies_.mass.data();
+        const GLfloat sx = px[body], sy = py[body], sz = pz[body];
+        const GLfloat Gm = G * mass[body];
+        if (!bodies_.active(body))
+        {
+            // only awake bodies feel it
+            for (int t=body+1; t<bodies_.size(); t++)
+            {
+                if (!bodies_.active(t)) continue;
+                GLfloat dx = px[t] - sx, dy = py[t] - sy, dz = pz[t] - sz;
+                GLfloat r = std::sqrt(dx*dx + dy*dy + dz*dz);
+                GLfloat f = Gm * mass[t] / ((r*r + eps) * (r + eps));
+                fx[t] -= f * dx;
+                fy[t] -= f * dy;
+                fz[t] -= f * dz;
+            }
+            return;
+        }
+
+        glm::vec3 sum(0);
+        kernels_.gravityRow(px, py, pz, mass, body + 1, bodies_.size(), glm::vec3(sx, sy, sz), Gm, eps,
+                            fx, fy, fz, sum);
+        fx[body] += sum.x;
+        fy[body] += sum.y;
+        fz[body] += sum.z;
     }
+
+    // context gravity: mg
+    auto m = bodies_.mass[body];
+    auto g = scene_->context().g;
+
+    fz[body] += -m*g;
 }
 
-PhysicsModule::~PhysicsModule()
+glm::vec3 PhysicsModule::getGravity(int s, int t)
 {
-    finish();
+    glm::vec3 v = bodies_.position(t) - bodies_.position(s); // directed
+    GLfloat m1 = bodies_.mass[s];
+    GLfloat m2 = bodies_.mass[t];
+    GLfloat G = scene_->context().G;
+    
+    GLfloat r = glm::sqrt(glm::dot(v, v));
+    glm::vec3 F = (G*m1*m2) / (r*r + eps) * (v/(r+eps));
+
+    return F;
 }
 
-void PhysicsModule::setScene(std::shared_ptr<Scene::Scene> scene)
+glm::vec3 PhysicsModule::getSourceGravity(int body)
 {
-    scene_ = scene;
-    for (auto &object : scene_->objects())
+    // same softening as the exact sum. Test particles sum over the sources,
+    // sources over every body so the pull between a source and a test
+    // particle stays mutual; S rows of N plus N rows of S
+    const GLfloat *px = bodies_.px.data(), *py = bodies_.py.data(), *pz = bodies_.pz.data();
+    const GLfloat *mass = bodies_.mass.data();
+    const GLfloat sx = px[body], sy = py[body], sz = pz[body];
+    const GLfloat Gm = scene_->context().G * mass[body];
+    GLfloat Fx = 0, Fy = 0, Fz = 0;
+    auto pull = [&](int s)
     {
-        // next state
-        objectNextStates_.push_back(object->state());
-        
-        // collision
-        std::vector<bool> collision;
-        for (int i=0; i<(int)scene_->objects().size(); i++)
-        {
-            collision.push_back(false);
-        }
-        objectCollisionStates_.push_back(collision);
-
-        // sink
-        std::vector<GLfloat> sink;
-        for (int i=0; i<(int)scene_->objects().size(); i++)
+        GLfloat dx = px[s] - sx, dy = py[s] - sy, dz = pz[s] - sz;
+        GLfloat r = std::sqrt(dx*dx + dy*dy + dz*dz);
+        GLfloat f = Gm * mass[s] / ((r*r + eps) * (r + eps));
+        Fx += f * dx;
+        Fy += f * dy;
+        Fz += f * dz;
+    };
+    if (gravitySource_[body])
+    {
+        for (int s=0; s<bodies_.size(); s++)
         {
-            sink.push_back(0);
+            if (s != body) pull(s);
         }
-        objectCollisionSink_.push_back(sink);
-
-        // normal
-        std::vector<glm::vec3> normal;
-        for (int i=0; i<(int)scene_->objects().size(); i++)
+    }
+    else
+    {
+        for (int s : gravitySources_)
         {
-            normal.push_back(glm::vec3{0});
+            pull(s);
         }
-        objectCollisionNormal_.push_back(normal);
     }
+    return glm::vec3(Fx, Fy, Fz);
 }
 
-void PhysicsModule::start()
+void PhysicsModule::applyCollisionForces(int body, ForceAccumulator &forces)
 {
-    master_->run(&PhysicsModule::simulate);
+    for (int k=contactOffsets_[body]; k<contactOffsets_[body + 1]; k++)
+    {
+        auto &contact = (*contactList_)[contactRefs_[k]];
+        glm::vec3 f = getCollisionForce(contact);
+        forces.fx[contact.body1] += f.x;
+        forces.fy[contact.body1] += f.y;
+        forces.fz[contact.body1] += f.z;
+        forces.fx[contact.body2] -= f.x;
+        forces.fy[contact.body2] -= f.y;
+        forces.fz[contact.body2] -= f.z;
+    }
 }
 
-void PhysicsModule::pause()
+glm::vec3 PhysicsModule::getCollisionForce(const ContactStore::Contact &contact)
 {
+    // force on body1, body2 gets the opposite
+    glm::vec3 n = contact.normal / (glm::length(contact.normal) + eps);
+    GLfloat sink = contact.sink < 0 ? -contact.sink : contact.sink;
+    return sink * n * 1000.0f;
 }
 
-void PhysicsModule::finish()
+glm::vec3 PhysicsModule::getAcceleration(int body, glm::vec3 F)
 {
-    run_ = false;
-    if (!master_->join())
-    {
-        std::cerr << "Master thread isn't joinable." << std::endl;
-        exit(EXIT_FAILURE);
-    }
+    // F = ma -> a = F/m
+    return F / (bodies_.mass[body] + eps);
 }
 
-void PhysicsModule::pushEvents()
+void PhysicsModule::updateCollisionStates(unsigned int worker)
 {
-    for (int i=0; i<(int)scene_->objects().size(); i++)
+    while (true)
     {
-        eventQueue_.push_back(i);
+        int event = getEvent(worker);
+        if (event == -1)
+            break;
+
+        testCollision(event, worker);
     }
 }
 
-void PhysicsModule::workersJoin()
+void PhysicsModule::updateContacts() // run by master
 {
-    for (auto &worker : workers_) {
-        if (!worker->join())
+    // merge what the workers found
+    contacts_.begin();
+    for (auto &found : workerContacts_)
+    {
+        for (auto &contact : found)
         {
-            std::cerr << "Worker thread isn't joinable." << std::endl;
-            exit(EXIT_FAILURE);
+            auto &stored = contacts_.touch(contact.body1, contact.body2);
+            setCollisionSink(stored, contact.sink);
+            stored.depth = contact.depth;
+            std::copy(contact.points, contact.points + contact.pointCount, stored.points);
+            stored.pointCount = contact.pointCount;
+            stored.normal = stored.body1 == contact.body1 ? contact.normal : -contact.normal;
         }
+        found.clear();
     }
+    contacts_.end();
+    buildContactLists(contacts_.contacts());
 }
 
-int PhysicsModule::getEvent()
+void PhysicsModule::updateStageContacts() // run by master
 {
-    int event = -1;
-    eventMutex_.lock();
-    if (eventQueue_.size() > 0)
+    // the stored contacts keep the state of the tick, stage contacts are
+    // only needed for this evaluation; pairs are tested once, no merging
+    stageContacts_.clear();
+    for (auto &found : workerContacts_)
     {
-        event = eventQueue_.front();
-        eventQueue_.pop_front();
+        stageContacts_.insert(stageContacts_.end(), found.begin(), found.end());
+        found.clear();
     }
-    eventMutex_.unlock();
-    return event;
+    buildContactLists(stageContacts_);
 }
 
-void PhysicsModule::simulate()
+void PhysicsModule::buildContactLists(const std::vector<ContactStore::Contact> &contacts)
 {
-    std::chrono::duration<double, std::micro> elapsed;
-
-    while (run_)
+    // contacts -> contact lists of their body1
+    int n = bodies_.size();
+    contactList_ = &contacts;
+    contactOffsets_.assign(n + 1, 0);
+    for (auto &contact : contacts)
     {
-        auto t1 = std::chrono::high_resolution_clock::now();
-
-        if (pause_) continue;
+        contactOffsets_[contact.body1 + 1]++;
+    }
+    for (int i=0; i<n; i++)
+    {
+        contactOffsets_[i + 1] += contactOffsets_[i];
+    }
+    contactRefs_.resize(contactOffsets_.back());
+    std::vector<int> fill(contactOffsets_.begin(), contactOffsets_.end() - 1);
+    for (int c=0; c<(int)contacts.size(); c++)
+    {
+        contactRefs_[fill[contacts[c].body1]++] = c;
+    }
+}
 
-        simulationUpdate();
+void PhysicsModule::updateIslands() // run by master
+{
+    int n = bodies_.size();
+    auto &contacts = contacts_.contacts();
 
-        while (true) // use spin lock for high persicision
+    // an awake body touching a sleeping one wakes the sleeper's whole island
+    bool wake = false;
+    wakeIslands_.assign(n, 0);
+    for (auto &contact : contacts)
+    {
+        int body1 = contact.body1, body2 = contact.body2;
+        if (bodies_.sleeping(body1) && bodies_.active(body2))
+        {
+            wakeIslands_[sleepIsland_[body1]] = wake = true;
+        }
+        else if (bodies_.sleeping(body2) && bodies_.active(body1))
         {
-            auto t2 = std::chrono::high_resolution_clock::now();
-            elapsed = t2 - t1;
-            if (elapsed.count() >= updateInterval_) break;
+            wakeIslands_[sleepIsland_[body2]] = wake = true;
+        }
+    }
+    for (int i=0; wake && i<n; i++)
+    {
+        if (bodies_.sleeping(i) && wakeIslands_[sleepIsland_[i]])
+        {
+            bodies_.setSleeping(i, false);
+            sleepIsland_[i] = -1;
+            restTime_[i] = 0;
         }
-        // std::cout << elapsed.count() << std::endl;
-        // printf("%f\n", elapsed.count());
     }
-}
 
-void PhysicsModule::simulationUpdate() // run by master
-{
-    if (!scene_)
+    // islands of awake bodies, static bodies don't join islands together
+    islands_.reset(n);
+    for (auto &contact : contacts)
     {
-        std::cerr << "Scene is null while simulation is running" << std::endl;
-        exit(EXIT_FAILURE);
+        if (bodies_.active(contact.body1) && bodies_.active(contact.body2))
+        {
+            islands_.unite(contact.body1, contact.body2);
+        }
     }
 
-    if (objectNextStates_.size() != scene_->objects().size())
+    // an island sleeps when all of it has been resting for sleepTime while
+    // lying on something static, free bodies keep moving under gravity
+    islandRest_.assign(n, context_.sleepTime);
+    islandSupported_.assign(n, 0);
+    GLfloat limit = context_.sleepVelocity * context_.sleepVelocity;
+    int awake = 0, sleeping = 0, islands = 0;
+    for (int i=0; i<n; i++)
     {
-        std::cerr << "Size of current and next states mismatch" << std::endl;
-        exit(EXIT_FAILURE);
+        if (bodies_.sleeping(i)) sleeping++;
+        if (!bodies_.active(i)) continue;
+
+        glm::vec3 v = bodies_.velocity(i);
+        restTime_[i] = glm::dot(v, v) < limit ? restTime_[i] + tick_ : 0;
+        int root = islands_.find(i);
+        islandRest_[root] = std::min(islandRest_[root], restTime_[i]);
+        if (root == i) islands++;
+        awake++;
+    }
+    for (auto &contact : contacts)
+    {
+        if (!bodies_.movable(contact.body1) && bodies_.active(contact.body2))
+        {
+            islandSupported_[islands_.find(contact.body2)] = 1;
+        }
+        else if (!bodies_.movable(contact.body2) && bodies_.active(contact.body1))
+        {
+            islandSupported_[islands_.find(contact.body1)] = 1;
+        }
     }
 
-    if (!eventQueue_.empty())
+    for (int i=0; context_.sleep && i<n; i++)
     {
-        std::cerr << "Event queue is not empty before updating" << std::endl;
-        exit(EXIT_FAILURE);
+        if (!bodies_.active(i)) continue;
+        int root = islands_.find(i);
+        if (islandSupported_[root] && islandRest_[root] >= context_.sleepTime)
+        {
+            bodies_.setSleeping(i, true);
+            bodies_.setVelocity(i, glm::vec3(0));
+            sleepIsland_[i] = root;
+            awake--;
+            sleeping++;
+            if (root == i) islands--;
+        }
     }
 
-    // collision test
-    pushEvents();
-    for (auto &worker : workers_) { worker->run(&PhysicsModule::updateCollisionStates); }
-    for (auto &worker : workers_) { worker->join(); }
+    awakeBodies_ = awake;
+    sleepingBodies_ = sleeping;
+    awakeIslands_ = islands;
+    PROFILE_BODIES(profiler_, awake, sleeping);
+}
+
+void PhysicsModule::solveContacts() // run by master
+{
+    if (context_.contactModel != ContactModel::Impulse) return;
 
-    // for (int i=0; i<(int)scene_->objects().size(); i++)
-    // {
-    //     for (int j=0; j<(int)scene_->objects().size(); j++)
-    //         std::cout << objectCollisionSink_[i][j] << " ";
-    //     std::cout << std::endl;
-    // }
-    // std::cout << std::endl;
+    PROFILE_PHASE(profiler_, Solver);
 
-    // get next states
-    pushEvents();
-    for (auto &worker : workers_) { worker->run(&PhysicsModule::updateNextStates); }
-    for (auto &worker : workers_) { worker->join(); }
+    // contacts -> contact lists of their island, islands share no movable
+    // body, so every island is one event and workers never write the same body
+    int n = bodies_.size();
+    auto &contacts = contacts_.contacts();
+    solverIslands_.assign(n, -1);
+    solverOffsets_.assign(1, 0);
+    for (auto &contact : contacts)
+    {
+        int body = bodies_.active(contact.body1) ? contact.body1 : contact.body2;
+        if (!bodies_.active(body)) continue;
+        int root = islands_.find(body);
+        if (solverIslands_[root] == -1)
+        {
+            solverIslands_[root] = (int)solverOffsets_.size() - 1;
+            solverOffsets_.push_back(0);
+        }
+        solverOffsets_[solverIslands_[root] + 1]++;
+    }
+    int islands = (int)solverOffsets_.size() - 1;
+    if (islands == 0) return;
 
-    // update states
-    for (int i=0; i<(int)scene_->objects().size(); i++)
+    for (int k=0; k<islands; k++)
     {
-        auto object = scene_->objects()[i];
-        object->displace(objectNextStates_[i].velocity * tick_);
-        object->accelerate(objectNextStates_[i].velocity - object->state().velocity);
+        solverOffsets_[k + 1] += solverOffsets_[k];
     }
-    // std::cout << glm::to_string(scene_->objects()[0]->state().centroid) << std::endl;
+    solverRefs_.resize(solverOffsets_.back());
+    std::vector<int> fill(solverOffsets_.begin(), solverOffsets_.end() - 1);
+    for (int c=0; c<(int)contacts.size(); c++)
+    {
+        int body = bodies_.active(contacts[c].body1) ? contacts[c].body1 : contacts[c].body2;
+        if (!bodies_.active(body)) continue;
+        solverRefs_[fill[solverIslands_[islands_.find(body)]]++] = c;
+    }
+    solverContacts_.resize(contacts.size());
+    pushVelocities_.resize(n, glm::vec3(0));
+
+    runPhase(&PhysicsModule::solveIslands, islands);
 }
 
-void PhysicsModule::updateNextStates()
+void PhysicsModule::solveIslands(unsigned int worker)
 {
+    auto &contacts = contacts_.contacts();
     while (true)
     {
-        int event = getEvent();
+        int event = getEvent(worker);
         if (event == -1)
             break;
 
-        auto object = scene_->objects()[event];
-
-        // sum of forces
-        glm::vec3 F{0};
-        F += getGravity(object, scene_);
-        F += getCollisionForce(object, scene_);
-
-        // changes
-        auto dv = getVelocityChange(object, F);
-
-        // update states
-        if (object->state().movable)
+        int begin = solverOffsets_[event], end = solverOffsets_[event + 1];
+        // approach velocities are taken before any warm start changes them
+        for (int k=begin; k<end; k++)
+        {
+            prepareContact(contacts[solverRefs_[k]], solverContacts_[solverRefs_[k]]);
+        }
+        for (int k=begin; k<end; k++)
+        {
+            warmStart(contacts[solverRefs_[k]], solverContacts_[solverRefs_[k]]);
+        }
+        for (unsigned int iteration=0; iteration<context_.solverIterations; iteration++)
         {
-            objectNextStates_[object->id()].velocity += dv;
+            for (int k=begin; k<end; k++)
+            {
+                solveContact(contacts[solverRefs_[k]], solverContacts_[solverRefs_[k]]);
+            }
         }
 
-        // for (int i=0; i<(int)scene_->objects().size(); i++)
-        // {
-        //     if (objectCollisionStates_[object->id()][i])
-        //     {
-        //         objectNextStates_[object->id()].velocity = glm::vec3{0};
-        //     }
-        // }
+        // overlap is removed by a separate pass on pseudo velocities, so the
+        // correction moves the bodies but doesn't launch them
+        for (unsigned int iteration=0; iteration<context_.solverIterations; iteration++)
+        {
+            for (int k=begin; k<end; k++)
+            {
+                solvePush(contacts[solverRefs_[k]], solverContacts_[solverRefs_[k]]);
+            }
+        }
+        for (int k=begin; k<end; k++)
+        {
+            applyPush(contacts[solverRefs_[k]].body1);
+            applyPush(contacts[solverRefs_[k]].body2);
+        }
     }
 }
 
-glm::vec3 PhysicsModule::getGravity(std::shared_ptr<Scene::Object> object,
-                                    std::shared_ptr<Scene::Scene> scene)
+void PhysicsModule::prepareContact(ContactStore::Contact &contact, SolverContact &solver)
 {
-    glm::vec3 F{0};
-    for (auto other : scene->objects())
-    {
-        F += getGravity(object, other);
-    }
+    // overlap beyond the slop is pushed out over a few ticks (Baumgarte),
+    // approaches faster than restitutionVelocity bounce back
+    const GLfloat baumgarte = 0.2f, slop = 0.01f, restitutionVelocity = 1.0f;
+
+    glm::vec3 n = contact.normal / (glm::length(contact.normal) + eps);
+    solver.normal = n;
+    solver.mass = 1 / (inverseMass(contact.body1) + inverseMass(contact.body2) + eps);
+
+    GLfloat vn = glm::dot(bodies_.velocity(contact.body1) - bodies_.velocity(contact.body2), n);
+    solver.bounce = -vn > restitutionVelocity ? -context_.restitution * vn : 0;
+    solver.push = baumgarte / tick_ * std::max(contact.depth - slop, 0.0f);
+    solver.pushImpulse = 0;
+}
 
-    // context gravity: mg
-    auto m = object->state().mass;
-    auto g = scene->context().g;
+void PhysicsModule::warmStart(ContactStore::Contact &contact, const SolverContact &solver)
+{
+    // start from what held the contact last tick, the tangent part follows
+    // the new normal
+    const glm::vec3 &n = solver.normal;
+    contact.friction -= n * glm::dot(contact.friction, n);
+    applyImpulse(contact, n * contact.impulse + contact.friction);
+}
 
-    F += glm::vec3(0, 0, -m*g);
+void PhysicsModule::solveContact(ContactStore::Contact &contact, const SolverContact &solver)
+{
+    // normal: accumulated impulse may only push
+    const glm::vec3 &n = solver.normal;
+    glm::vec3 v = bodies_.velocity(contact.body1) - bodies_.velocity(contact.body2);
+    GLfloat impulse = std::max(contact.impulse + (solver.bounce - glm::dot(v, n)) * solver.mass, 0.0f);
+    applyImpulse(contact, n * (impulse - contact.impulse));
+    contact.impulse = impulse;
+
+    // friction: cancel the sliding velocity, inside the cone of the normal impulse
+    v = bodies_.velocity(contact.body1) - bodies_.velocity(contact.body2);
+    glm::vec3 friction = contact.friction - (v - n * glm::dot(v, n)) * solver.mass;
+    GLfloat limit = context_.friction * contact.impulse;
+    GLfloat length2 = glm::dot(friction, friction);
+    if (length2 > limit * limit) friction *= limit / glm::sqrt(length2);
+    applyImpulse(contact, friction - contact.friction);
+    contact.friction = friction;
+}
 
-    return F;
+void PhysicsModule::solvePush(const ContactStore::Contact &contact, SolverContact &solver)
+{
+    GLfloat inverse1 = inverseMass(contact.body1), inverse2 = inverseMass(contact.body2);
+    glm::vec3 v = pushVelocities_[contact.body1] - pushVelocities_[contact.body2];
+    GLfloat impulse = std::max(solver.pushImpulse + (solver.push - glm::dot(v, solver.normal)) * solver.mass, 0.0f);
+    glm::vec3 push = solver.normal * (impulse - solver.pushImpulse);
+    solver.pushImpulse = impulse;
+    if (inverse1 > 0) pushVelocities_[contact.body1] += push * inverse1;
+    if (inverse2 > 0) pushVelocities_[contact.body2] -= push * inverse2;
 }
 
-glm::vec3 PhysicsModule::getGravity(std::shared_ptr<Scene::Object> s,
-                                    std::shared_ptr<Scene::Object> t)
+void PhysicsModule::applyPush(int body)
 {
-    glm::vec3 v = t->state().centroid - s->state().centroid; // directed
-    GLfloat m1 = s->state().mass;
-    GLfloat m2 = t->state().mass;
-    GLfloat G = scene_->context().G;
-    
-    GLfloat r = glm::sqrt(glm::dot(v, v));
-    glm::vec3 F = (G*m1*m2) / (r*r + eps) * (v/(r+eps));
+    // once per body, the velocity is cleared for the next tick
+    if (inverseMass(body) <= 0) return;
+    bodies_.setPosition(body, bodies_.position(body) + pushVelocities_[body] * tick_);
+    pushVelocities_[body] = glm::vec3(0);
+}
 
-    return F;
+void PhysicsModule::applyImpulse(const ContactStore::Contact &contact, const glm::vec3 &impulse)
+{
+    // impulse on body1, body2 gets the opposite; bodies that don't give way
+    // may be shared by islands, so they are not even written
+    GLfloat inverse1 = inverseMass(contact.body1), inverse2 = inverseMass(contact.body2);
+    if (inverse1 > 0) bodies_.setVelocity(contact.body1, bodies_.velocity(contact.body1) + impulse * inverse1);
+    if (inverse2 > 0) bodies_.setVelocity(contact.body2, bodies_.velocity(contact.body2) - impulse * inverse2);
 }
 
-glm::vec3 PhysicsModule::getCollisionForce(std::shared_ptr<Scene::Object> object,
-                                            std::shared_ptr<Scene::Scene> scene)
+GLfloat PhysicsModule::inverseMass(int body)
 {
-    glm::vec3 F{0};
-    for (auto other : scene->objects())
-    {
-        F += getCollisionForce(object, other);
-    }
-    return F;
+    // static and sleeping bodies don't give way
+    return bodies_.active(body) ? 1 / (bodies_.mass[body] + eps) : 0;
 }
 
-glm::vec3 PhysicsModule::getCollisionForce(std::shared_ptr<Scene::Object> obj1,
-                                            std::shared_ptr<Scene::Object> obj2)
+void PhysicsModule::sweepFastBodies() // run by master
 {
-    if (objectCollisionStates_[obj1->id()][obj2->id()])
+    if (context_.sweepFraction <= 0) return;
+
+    // few bodies are fast enough, and a hit changes the velocity of the
+    // other body too, so this stays on the master
+    PROFILE_PHASE(profiler_, Sweep);
+    sweepBodies_.clear();
+    for (int i=0; i<bodies_.size(); i++)
     {
-        auto &sink = objectCollisionSink_[obj1->id()][obj2->id()];
-        auto &normal = objectCollisionNormal_[obj1->id()][obj2->id()];
+        if (!bodies_.active(i) || bodies_.type(i) != Scene::Body::Type::Sphere) continue;
 
-        glm::vec3 n = normal / glm::sqrt(glm::dot(normal, normal));
-        // glm::vec3 v = obj1->state().velocity - obj2->state().velocity;
+        glm::vec3 move = bodies_.position(i) - sweepStarts_[i];
+        GLfloat limit = context_.sweepFraction * bodies_.rx[i];
+        if (glm::dot(move, move) > limit * limit) sweepBodies_.push_back(i);
+    }
+    if (sweepBodies_.empty()) return;
 
-        sink = sink < 0 ? -sink : sink;
-        // std::cout << glm::to_string(normal * 1000.0f) << std::endl;
-        return sink * n * 1000.0f;
+    // sub-steps look their targets up in the trees, whose leaves are made to
+    // cover every path of the tick; the grid only knows the pairs of the
+    // boxes it was built from, so it uses the trees too
+    bool trees = context_.broadPhase != BroadPhase::BruteForce;
+    if (trees)
+    {
+        for (int i=0; i<bodies_.size(); i++)
+        {
+            if (bodies_.movable(i)) dynamicTree_.move(treeProxies_[i], getSweptBox(i), glm::vec3(0));
+        }
     }
-    else
+    for (int i : sweepBodies_)
     {
-        return glm::vec3{0};
+        sweepBody(i);
+        // its path changed, later sweeps see the new one
+        if (trees) dynamicTree_.move(treeProxies_[i], getSweptBox(i), glm::vec3(0));
     }
 }
 
-glm::vec3 PhysicsModule::getVelocityChange(std::shared_ptr<Scene::Object> object,
-                                           glm::vec3 F)
+void PhysicsModule::sweepBody(int body) // run by master
 {
-    // F = ma -> a = F/m
-    glm::vec3 a = F / (object->state().mass + eps);
-    return a * tick_;
+    // sub-steps: move to the first impact of the tick, bounce, and go on
+    // with the velocity left for the rest of the tick; other bodies move
+    // linearly from their start to their end of the tick meanwhile
+    glm::vec3 start = sweepStarts_[body];
+    glm::vec3 move = bodies_.position(body) - start;
+    GLfloat left = 1; // share of the tick not moved yet
+    for (unsigned int step=0; step<context_.sweepSteps; step++)
+    {
+        // bodies whose path box meets this sub-step's, in index order so
+        // that ties go the same way as with brute force
+        sweepOthers_.clear();
+        if (context_.broadPhase == BroadPhase::BruteForce)
+        {
+            for (int other=0; other<bodies_.size(); other++)
+            {
+                sweepOthers_.push_back(other);
+            }
+        }
+        else
+        {
+            glm::vec3 r(bodies_.rx[body]);
+            Aabb box{glm::min(start, start + move) - r, glm::max(start, start + move) + r};
+            auto visit = [&](int other)
+            {
+                sweepOthers_.push_back(other);
+                return true;
+            };
+            dynamicTree_.query(box, visit);
+            staticTree_.query(box, visit);
+            std::sort(sweepOthers_.begin(), sweepOthers_.end());
+        }
+
+        GLfloat first = 1;
+        int hit = -1;
+        glm::vec3 normal{0};
+        for (int other : sweepOthers_)
+        {
+            if (other == body) continue;
+
+            glm::vec3 otherMove = bodies_.position(other) - sweepStarts_[other];
+            glm::vec3 otherStart = sweepStarts_[other] + otherMove * (1 - left);
+            otherMove *= left;
+
+            GLfloat time;
+            glm::vec3 hitNormal{0};
+            bool swept = bodies_.type(other) == Scene::Body::Type::Sphere ?
+                sweepSphereSphere(body, start, move, other, otherStart, otherMove, time, hitNormal) :
+                sweepSphereCube(body, start, move, other, otherStart, otherMove, time, hitNormal);
+            if (swept && time < first)
+            {
+                first = time;
+                hit = other;
+                normal = hitNormal;
+            }
+        }
+
+        if (hit == -1)
+        {
+            bodies_.setPosition(body, start + move);
+            return;
+        }
+
+        // impact response of a contact with restitution, friction is left
+        // to the solver once the contact is found the regular way
+        start += move * first;
+        GLfloat inverse1 = inverseMass(body), inverse2 = inverseMass(hit);
+        GLfloat vn = glm::dot(bodies_.velocity(body) - bodies_.velocity(hit), normal);
+        if (vn < 0)
+        {
+            glm::vec3 impulse = normal * (-(1 + context_.restitution) * vn / (inverse1 + inverse2 + eps));
+            bodies_.setVelocity(body, bodies_.velocity(body) + impulse * inverse1);
+            if (inverse2 > 0) bodies_.setVelocity(hit, bodies_.velocity(hit) - impulse * inverse2);
+        }
+        left *= 1 - first;
+        move = bodies_.velocity(body) * (tick_ * left);
+    }
+
+    // out of sub-steps, stay at the last impact
+    bodies_.setPosition(body, start);
 }
 
-void PhysicsModule::updateCollisionStates()
+bool PhysicsModule::sweepSphereSphere(int sphere, const glm::vec3 &start, const glm::vec3 &move,
+                                      int other, const glm::vec3 &otherStart, const glm::vec3 &otherMove,
+                                      GLfloat &time, glm::vec3 &normal)
 {
-    while (true)
+    // |p + t d| = r1 + r2 for the relative motion, first root in [0, 1]
+    GLfloat r = bodies_.rx[sphere] + bodies_.rx[other];
+    glm::vec3 p = start - otherStart;
+    glm::vec3 d = move - otherMove;
+    GLfloat a = glm::dot(d, d);
+    GLfloat b = 2 * glm::dot(p, d);
+    GLfloat c = glm::dot(p, p) - r * r;
+    if (c <= 0 || b >= 0) return false; // already touching or moving apart
+
+    GLfloat discriminant = b * b - 4 * a * c;
+    if (discriminant < 0) return false;
+
+    time = (-b - glm::sqrt(discriminant)) / (2 * a + eps);
+    if (time > 1) return false;
+
+    normal = glm::normalize(p + d * time);
+    return true;
+}
+
+bool PhysicsModule::sweepSphereCube(int sphere, const glm::vec3 &start, const glm::vec3 &move,
+                                    int cube, const glm::vec3 &cubeStart, const glm::vec3 &cubeMove,
+                                    GLfloat &time, glm::vec3 &normal)
+{
+    // ray of the center against the box grown by the radius (slab test in
+    // box space); edges and corners are hit a little early, never missed
+    const Box &box = boxes_[cube];
+    GLfloat r = bodies_.rx[sphere];
+    glm::vec3 p = start - cubeStart;
+    glm::vec3 d = move - cubeMove;
+    GLfloat enter = -1, exit = 2;
+    glm::vec3 face;
+    for (int k=0; k<3; k++)
     {
-        int event = getEvent();
-        if (event == -1)
-            break;
+        const glm::vec3 &unit = box.axes[k];
+        GLfloat pk = glm::dot(p, unit), dk = glm::dot(d, unit), extent = box.half[k] + r;
+        if (std::abs(dk) < eps)
+        {
+            if (std::abs(pk) > extent) return false;
+            continue;
+        }
 
-        auto object = scene_->objects()[event];
-        testCollision(object, scene_);
+        GLfloat t1 = (-extent - pk) / dk, t2 = (extent - pk) / dk;
+        glm::vec3 side = -unit;
+        if (t1 > t2)
+        {
+            std::swap(t1, t2);
+            side = unit;
+        }
+        if (t1 > enter)
+        {
+            enter = t1;
+            face = side;
+        }
+        exit = std::min(exit, t2);
     }
+
+    // entering before the tick means it is already touching
+    if (enter < 0 || enter > exit || enter > 1) return false;
+
+    time = enter;
+    normal = face;
+    return true;
 }
 
-void PhysicsModule::testCollision(std::shared_ptr<Scene::Object> object,
-                                  std::shared_ptr<Scene::Scene> scene)
+void PhysicsModule::testCollision(int body, unsigned int worker) // pairs (body, j > body)
 {
-    for (auto other : scene->objects())
+    auto &found = workerContacts_[worker];
+    ContactStore::Contact contact{};
+    bool active = bodies_.active(body); // pairs without an awake body are skipped
+
+    // box pairs not tested last tick have left the broad phase
+    auto &axes = separatingAxes_[body];
+    unsigned long tick = tickCount_;
+    axes.erase(std::remove_if(axes.begin(), axes.end(),
+                              [tick](const SeparatingAxis &s) { return s.tick + 1 < tick; }),
+               axes.end());
+    if (context_.broadPhase != BroadPhase::BruteForce)
     {
-        if (object->id() != other->id())
+        PROFILE_COUNT(profiler_, worker, pairsTested, candidateOffsets_[body + 1] - candidateOffsets_[body]);
+        for (int k=candidateOffsets_[body]; k<candidateOffsets_[body + 1]; k++)
         {
-            objectCollisionStates_[object->id()][other->id()] = testCollision(object, other);
+            if (!active && !bodies_.active(candidates_[k])) continue;
+            if (testCollision(body, candidates_[k], contact))
+            {
+                found.push_back(contact);
+                PROFILE_COUNT(profiler_, worker, contactsFound, 1);
+            }
         }
-        else
+        return;
+    }
+
+    // bounding spheres first, the exact tests only run on the ones overlapping
+    PROFILE_COUNT(profiler_, worker, pairsTested, bodies_.size() - body - 1);
+    int *hits = workerHits_[worker].data();
+    int hitCount = kernels_.sphereOverlap(bodies_.px.data(), bodies_.py.data(), bodies_.pz.data(),
+                                          bodies_.bound.data(), body + 1, bodies_.size(),
+                                          bodies_.position(body), bodies_.bound[body], hits);
+    for (int k=0; k<hitCount; k++)
+    {
+        int other = hits[k];
+        if (!active && !bodies_.active(other)) continue;
+        if (testCollision(body, other, contact))
         {
-            objectCollisionStates_[object->id()][other->id()] = false;
+            found.push_back(contact);
+            PROFILE_COUNT(profiler_, worker, contactsFound, 1);
         }
     }
 }
 
-bool PhysicsModule::testCollision(std::shared_ptr<Scene::Object> obj1,
-                                  std::shared_ptr<Scene::Object> obj2)
+bool PhysicsModule::testCollision(int body1, int body2, ContactStore::Contact &contact)
 {
-    objectCollisionSink_[obj1->id()][obj2->id()] = 0;
+    contact.sink = 0;
 
-    if (obj1->state().type == Scene::Object::Type::Sphere &&
-        obj2->state().type == Scene::Object::Type::Sphere)
+    auto type1 = bodies_.type(body1);
+    auto type2 = bodies_.type(body2);
+    if (type1 == Scene::Body::Type::Sphere &&
+        type2 == Scene::Body::Type::Sphere)
     {
-        return collisionSphereSphere(obj1, obj2);
+        return collisionSphereSphere(body1, body2, contact);
     }
-    else if (obj1->state().type == Scene::Object::Type::Sphere &&
-             obj2->state().type == Scene::Object::Type::Cube)
+    else if (type1 == Scene::Body::Type::Sphere &&
+             type2 == Scene::Body::Type::Cube)
     {
-        return collisionSphereCube(obj1, obj2);
+        return collisionSphereCube(body1, body2, contact);
     }
-    else if (obj1->state().type == Scene::Object::Type::Cube &&
-             obj2->state().type == Scene::Object::Type::Sphere)
+    else if (type1 == Scene::Body::Type::Cube &&
+             type2 == Scene::Body::Type::Sphere)
     {
-        return collisionSphereCube(obj2, obj1);
+        return collisionSphereCube(body2, body1, contact);
     }
-    else if (obj1->state().type == Scene::Object::Type::Cube &&
-             obj2->state().type == Scene::Object::Type::Cube)
+    else if (type1 == Scene::Body::Type::Cube &&
+             type2 == Scene::Body::Type::Cube)
     {
-
+        return collisionCubeCube(body1, body2, contact);
     }
     else
     {
         std::cerr << "[ERROR] Unknown collision type pair: " 
-                  << (int)obj1->state().type << ", " << (int)obj2->state().type << std::endl;
+                  << (int)type1 << ", " << (int)type2 << std::endl;
         exit(EXIT_FAILURE);
     }
     return false;
 }
 
-bool PhysicsModule::collisionSphereSphere(std::shared_ptr<Scene::Object> sphere1,
-                                          std::shared_ptr<Scene::Object> sphere2)
+bool PhysicsModule::collisionSphereSphere(int sphere1, int sphere2,
+                                          ContactStore::Contact &contact)
 {
-    GLfloat r1 = sphere1->state().radius.x;
-    GLfloat r2 = sphere2->state().radius.x;
+    GLfloat r1 = bodies_.rx[sphere1];
+    GLfloat r2 = bodies_.rx[sphere2];
 
-    glm::vec3 v = sphere1->state().centroid - sphere2->state().centroid;
+    glm::vec3 v = bodies_.position(sphere1) - bodies_.position(sphere2);
     GLfloat dist2 = glm::dot(v, v);
     GLfloat sink = dist2 - (r1+r2)*(r1+r2);
     glm::vec3 normal = v;
     if (sink < 0)
     {
-        setCollisionSink(sphere1, sphere2, sink);
-        setCollisionNormal(sphere1, sphere2, normal);
+        contact.body1 = sphere1;
+        contact.body2 = sphere2;
+        GLfloat dist = glm::sqrt(dist2);
+        contact.depth = r1 + r2 - dist;
+        // coinciding centers have no direction, the point is then sphere2's center
+        contact.points[0] = bodies_.position(sphere2) + v / (dist + eps) * (r2 - contact.depth / 2);
+        contact.pointCount = 1;
+        setCollisionSink(contact, sink);
+        setCollisionNormal(contact, normal);
         return true;
     }
     else
         return false;
 }
 
-bool PhysicsModule::collisionSphereCube(std::shared_ptr<Scene::Object> sphere,
-                                        std::shared_ptr<Scene::Object> cube)
+bool PhysicsModule::collisionSphereCube(int sphere, int cube,
+                                        ContactStore::Contact &contact)
 {
-    bool collided = false;
-    GLfloat r2 = glm::dot(sphere->state().normals[0], sphere->state().normals[0]);
-
-    // face test
-    for (int n=0; n<(int)cube->state().normals.size(); n++)
+    // closest point of the box to the center, no allocation on this path
+    const Box &box = boxes_[cube];
+    GLfloat r = bodies_.rx[sphere];
+    glm::vec3 center = bodies_.position(sphere);
+    glm::vec3 offset = center - box.center;
+    glm::vec3 closest = box.center;
+    GLfloat local[3];
+    bool inside = true;
+    for (int k=0; k<3; k++)
     {
-        glm::vec3 normals[2];
-        normals[0] = cube->state().normals[n];
-        normals[1] = -cube->state().normals[n];
+        local[k] = glm::dot(offset, box.axes[k]);
+        GLfloat clamped = glm::clamp(local[k], -box.half[k], box.half[k]);
+        if (local[k] < -box.half[k] || local[k] > box.half[k]) inside = false;
+        closest += box.axes[k] * clamped;
+    }
 
-        for (auto &normal : normals)
+    glm::vec3 normal = center - closest;
+    GLfloat dist2 = glm::dot(normal, normal);
+    GLfloat sink = dist2 - r * r;
+    if (!inside)
+    {
+        if (sink >= 0) return false;
+        contact.depth = r - glm::sqrt(dist2);
+    }
+    else
+    {
+        // center inside the box: out through the nearest face, the sink
+        // keeps the scale of dist2 - r2 near the surface
+        int k = 0;
+        for (int i=1; i<3; i++)
         {
-            glm::vec3 plane = cube->state().centroid + normal;
-            GLfloat dist2 = dist2PointPlane(sphere->state().centroid, plane, normal);
-            GLfloat sink = dist2 - r2;
-            if (pointInFace(sphere->state().centroid, plane, normal, cube->state().normals, n) &&
-                sink < 0)
-            {
-                setCollisionSink(sphere, cube, sink);
-                setCollisionNormal(sphere, cube, normal);
-                collided = true;
-                // std::cout << "collided" << std::endl;
-                // std::cout << glm::to_string(sphere->state().centroid - plane) << std::endl;
-                // std::cout << glm::to_string(normal) << std::endl;
-                // std::cout << glm::dot(sphere->state().centroid - plane, normal) << std::endl;
-            }
+            if (box.half[i] - std::abs(local[i]) < box.half[k] - std::abs(local[k])) k = i;
         }
+        normal = local[k] < 0 ? -box.axes[k] : box.axes[k];
+        contact.depth = r + box.half[k] - std::abs(local[k]);
+        sink = -2 * r * contact.depth;
     }
 
-    // corner test
-    std::vector<glm::vec3> corners;
-    std::array<GLfloat, 2> signs = {1, -1};
-    for (auto s0 : signs)
-        for (auto s1 : signs)
-            for (auto s2 : signs)
-                corners.push_back(cube->state().centroid + s0 * cube->state().normals[0]
-                                                         + s1 * cube->state().normals[1]
-                                                         + s2 * cube->state().normals[2]);
-    for (const auto &corner : corners)
+    contact.body1 = sphere;
+    contact.body2 = cube;
+    contact.points[0] = center - glm::normalize(normal) * (r - contact.depth / 2);
+    contact.pointCount = 1;
+    setCollisionSink(contact, sink);
+    setCollisionNormal(contact, normal);
+    return true;
+}
+
+bool PhysicsModule::collisionCubeCube(int cube1, int cube2,
+                                      ContactStore::Contact &contact)
+{
+    // separating axis test: 3 + 3 face normals and 9 edge cross products,
+    // the axis of least overlap is the contact normal
+    const Box &box1 = boxes_[cube1], &box2 = boxes_[cube2];
+    glm::vec3 offset = box1.center - box2.center;
+
+    // pairs are tested by the worker of their lower body only, so its cache
+    // needs no lock; whatever kept the pair apart last tick usually still does
+    auto &cache = separatingAxes_[std::min(cube1, cube2)];
+    int other = std::max(cube1, cube2);
+    auto cached = std::find_if(cache.begin(), cache.end(),
+                               [other](const SeparatingAxis &s) { return s.other == other; });
+    if (cached != cache.end())
     {
-        GLfloat sink = dist2PointPoint(corner, sphere->state().centroid) - r2;
-        if (sink < 0)
+        cached->tick = tickCount_;
+        glm::vec3 axis = boxAxis(box1, box2, cached->axis);
+        if (glm::dot(axis, axis) > 1e-6f && boxOverlap(box1, box2, glm::normalize(axis)) < 0) return false;
+    }
+
+    // edge axes must be clearly shallower than face axes to be picked,
+    // otherwise resting boxes flip between nearly equal axes
+    int best = -1;
+    GLfloat bestOverlap = 0, bestScore = 0;
+    glm::vec3 bestAxis;
+    for (int a=0; a<15; a++)
+    {
+        glm::vec3 axis = boxAxis(box1, box2, a);
+        GLfloat length2 = glm::dot(axis, axis);
+        if (length2 < 1e-6f) continue; // parallel edges, the face axes cover them
+        axis /= glm::sqrt(length2);
+
+        GLfloat overlap = boxOverlap(box1, box2, axis);
+        if (overlap < 0)
         {
-            glm::vec3 normal = sphere->state().centroid - corner;
-            setCollisionSink(sphere, cube, sink);
-            setCollisionNormal(sphere, cube, normal);
-            collided = true;
+            if (cached != cache.end()) cached->axis = a;
+            else cache.push_back(SeparatingAxis{other, a, tickCount_});
+            return false;
+        }
+
+        GLfloat score = a < 6 ? overlap : overlap * 1.05f + 0.001f;
+        if (best == -1 || score < bestScore)
+        {
+            best = a;
+            bestOverlap = overlap;
+            bestScore = score;
+            bestAxis = axis;
         }
     }
+    if (cached != cache.end()) cache.erase(cached);
+    if (best == -1) return false;
+
+    // normal pushes box1 away from box2
+    glm::vec3 normal = glm::dot(bestAxis, offset) < 0 ? -bestAxis : bestAxis;
+    contact.body1 = cube1;
+    contact.body2 = cube2;
+    contact.depth = bestOverlap;
+    setCollisionSink(contact, -bestOverlap);
+    setCollisionNormal(contact, normal);
+    if (best < 3) setBoxFaceContact(box1, box2, -normal, contact);
+    else if (best < 6) setBoxFaceContact(box2, box1, normal, contact);
+    else setBoxEdgeContact(box1, (best - 6) / 3, box2, (best - 6) % 3, normal, contact);
+    return true;
+}
 
-    return collided;
+PhysicsModule::Box PhysicsModule::getBox(int cube)
+{
+    Box box;
+    box.center = bodies_.position(cube);
+    for (int k=0; k<3; k++)
+    {
+        box.half[k] = glm::length(bodies_.axes[k][cube]);
+        box.axes[k] = bodies_.axes[k][cube] / (box.half[k] + eps);
+    }
+    return box;
 }
 
-// bool PhysicsModule::collisionCubeCube(std::shared_ptr<Scene::Object> obj1,
-//                                       std::shared_ptr<Scene::Object> obj2)
-// {
-    
-// }
+void PhysicsModule::setBoxFaceContact(const Box &reference, const Box &incident,
+                                      const glm::vec3 &normal, ContactStore::Contact &contact)
+{
+    // normal: face normal of reference pointing to incident; the incident
+    // face most against it is clipped to the sides of the reference face
+    int r = 0, k = 0;
+    for (int i=1; i<3; i++)
+    {
+        if (std::abs(glm::dot(reference.axes[i], normal)) > std::abs(glm::dot(reference.axes[r], normal))) r = i;
+        if (std::abs(glm::dot(incident.axes[i], normal)) > std::abs(glm::dot(incident.axes[k], normal))) k = i;
+    }
+    glm::vec3 face = glm::dot(incident.axes[k], normal) > 0 ? -incident.axes[k] : incident.axes[k];
+    glm::vec3 faceCenter = incident.center + face * incident.half[k];
+    int u = (k + 1) % 3, v = (k + 2) % 3;
+    glm::vec3 eu = incident.axes[u] * incident.half[u], ev = incident.axes[v] * incident.half[v];
+
+    glm::vec3 polygon[8] = {faceCenter + eu + ev, faceCenter - eu + ev,
+                            faceCenter - eu - ev, faceCenter + eu - ev};
+    glm::vec3 clipped[8];
+    int count = 4;
+    for (int i=1; i<3 && count > 0; i++)
+    {
+        const glm::vec3 &side = reference.axes[(r + i) % 3];
+        GLfloat half = reference.half[(r + i) % 3];
+        GLfloat center = glm::dot(reference.center, side);
+        count = clipPolygon(polygon, count, side, center + half, clipped);
+        count = clipPolygon(clipped, count, -side, -center + half, polygon);
+    }
+
+    // points under the reference face, the deepest ones if there are more
+    glm::vec3 plane = reference.center + normal * reference.half[r];
+    GLfloat depths[8];
+    int kept = 0;
+    for (int i=0; i<count; i++)
+    {
+        GLfloat depth = -glm::dot(polygon[i] - plane, normal);
+        if (depth < 0) continue;
+        polygon[kept] = polygon[i];
+        depths[kept++] = depth;
+    }
+    contact.pointCount = 0;
+    for (int i=0; i<kept && contact.pointCount < ContactStore::MaxPoints; i++)
+    {
+        int deepest = i;
+        for (int j=i+1; j<kept; j++) if (depths[j] > depths[deepest]) deepest = j;
+        std::swap(polygon[i], polygon[deepest]);
+        std::swap(depths[i], depths[deepest]);
+        contact.points[contact.pointCount++] = polygon[i] + normal * (depths[i] / 2);
+    }
+}
 
-void PhysicsModule::setCollisionSink(std::shared_ptr<Scene::Object> obj1,
-                                    std::shared_ptr<Scene::Object> obj2,
-                                    GLfloat sink)
+void PhysicsModule::setBoxEdgeContact(const Box &box1, int edge1, const Box &box2, int edge2,
+                                      const glm::vec3 &normal, ContactStore::Contact &contact)
 {
-    objectCollisionSink_[obj1->id()][obj2->id()] = 
-        std::min(sink, objectCollisionSink_[obj1->id()][obj2->id()]);
-    objectCollisionSink_[obj2->id()][obj1->id()] = 
-        std::min(sink, objectCollisionSink_[obj2->id()][obj1->id()]);
+    // the edge of each box furthest towards the other, one point halfway
+    // between their closest points
+    glm::vec3 p1 = box1.center, p2 = box2.center;
+    for (int k=0; k<3; k++)
+    {
+        if (k != edge1) p1 += box1.axes[k] * (glm::dot(box1.axes[k], normal) > 0 ? -box1.half[k] : box1.half[k]);
+        if (k != edge2) p2 += box2.axes[k] * (glm::dot(box2.axes[k], normal) > 0 ? box2.half[k] : -box2.half[k]);
+    }
+    const glm::vec3 &d1 = box1.axes[edge1], &d2 = box2.axes[edge2];
+    glm::vec3 w = p1 - p2;
+    GLfloat b = glm::dot(d1, d2), d = glm::dot(d1, w), e = glm::dot(d2, w);
+    GLfloat denominator = 1 - b * b;
+    GLfloat s = 0, t = e;
+    if (denominator > 1e-6f)
+    {
+        s = glm::clamp((b * e - d) / denominator, -box1.half[edge1], box1.half[edge1]);
+        t = b * s + e;
+    }
+    t = glm::clamp(t, -box2.half[edge2], box2.half[edge2]);
+    contact.points[0] = (p1 + d1 * s + p2 + d2 * t) / 2.0f;
+    contact.pointCount = 1;
 }
 
-void PhysicsModule::setCollisionNormal(std::shared_ptr<Scene::Object> obj1,
-                                        std::shared_ptr<Scene::Object> obj2,
-                                        glm::vec3 &normal)
+void PhysicsModule::setCollisionSink(ContactStore::Contact &contact, GLfloat sink)
 {
-    // std::cout << glm::to_string(normal * 1000.0f) << std::endl;
+    contact.sink = std::min(sink, contact.sink);
+}
 
-    objectCollisionNormal_[obj1->id()][obj2->id()] = normal;
-    objectCollisionNormal_[obj2->id()][obj1->id()] = -normal;
+void PhysicsModule::setCollisionNormal(ContactStore::Contact &contact, glm::vec3 &normal)
+{
+    contact.normal = normal;
 }
 
 PhysicsModule::MasterThread::MasterThread(std::shared_ptr<PhysicsModule> physics)
@@ -476,7 +2237,9 @@ void PhysicsModule::MasterThread::run(Function&& f)
         std::cerr << "Master thread runs before joined" << std::endl;
         exit(EXIT_FAILURE);
     }
-    thread_.reset(new std::thread(f, physics_.lock().get()));
+    auto physics = physics_.lock();
+    thread_.reset(new std::thread(f, physics.get()));
+    if (physics->context_.affinity) setThreadAffinity(*thread_, 0);
 }
 
 bool PhysicsModule::MasterThread::join()
@@ -489,22 +2252,35 @@ bool PhysicsModule::MasterThread::join()
     return false;
 }
 
-static int idCount = 0;
-PhysicsModule::WorkerThread::WorkerThread(std::shared_ptr<PhysicsModule> physics)
-    : physics_{physics}, thread_{nullptr}
-{
-    id_ = idCount++;
-}
+PhysicsModule::WorkerThread::WorkerThread(std::shared_ptr<PhysicsModule> physics,
+                                          unsigned int id)
+    : id_{id}, physics_{physics}, thread_{nullptr}
+{}
 
-template<class Function>
-void PhysicsModule::WorkerThread::run(Function&& f)
+void PhysicsModule::WorkerThread::start()
 {
     if (join())
     {
-        std::cerr << "Worker thread runs before joined" << std::endl;
+        std::cerr << "Worker thread starts before joined" << std::endl;
         exit(EXIT_FAILURE);
     }
-    thread_.reset(new std::thread(f, physics_.lock().get()));
+    auto physics = physics_.lock();
+    thread_.reset(new std::thread(&WorkerThread::loop, this, physics.get()));
+    if (physics->context_.affinity) setThreadAffinity(*thread_, id_ + 1);
+}
+
+void PhysicsModule::WorkerThread::loop(PhysicsModule *physics)
+{
+    while (true)
+    {
+        physics->phaseBegin_->wait();
+        if (!physics->workersRun_) break;
+        {
+            PROFILE_WORKER(physics->profiler_, id_);
+            (physics->*(physics->phase_))(id_);
+        }
+        physics->phaseEnd_->wait();
+    }
 }
 
 bool PhysicsModule::WorkerThread::join()
@@ -519,54 +2295,54 @@ bool PhysicsModule::WorkerThread::join()
 
 } // namespace Engine
 
-bool pointInFace(const glm::vec3 &point, const glm::vec3 &plane, const glm::vec3 &normal,
-                 const std::array<glm::vec3, 3> &normals, const int n)
+void setThreadAffinity(std::thread &thread, unsigned int cpu)
 {
-    // if not on normal positive direction
-    if (glm::dot(normal, point-plane) < 0)
-    {
-        return false;
-    }
-
-    std::vector<glm::vec3> notPlaneNormals;
-    for (int i=0; i<3; i++) if (i != n) notPlaneNormals.push_back(normals[i]);
-    glm::vec3 corners[4];
-    corners[0] = plane + notPlaneNormals[0] + notPlaneNormals[1];
-    corners[1] = plane - notPlaneNormals[0] + notPlaneNormals[1];
-    corners[2] = plane - notPlaneNormals[0] - notPlaneNormals[1];
-    corners[3] = plane + notPlaneNormals[0] - notPlaneNormals[1];
-    for (int i=0; i<4; i++)
+#if defined(__linux__)
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % cores, &set);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &set) != 0)
     {
-        glm::vec3 e[2];
-        e[0] = corners[(i+4+1) % 4] - corners[i];
-        e[1] = corners[(i+4-1) % 4] - corners[i];
-        for (int j=0; j<2; j++)
-        {
-            glm::vec3 v = point - corners[i];
-            if (glm::dot(e[j], v) < 0)
-                return false;
-        }
+        std::cerr << "[WARNING] Failed to pin physics thread to core " << cpu % cores << std::endl;
     }
-    return true;
-
+#else
+    (void)thread;
+    (void)cpu;
+#endif
 }
 
-GLfloat dist2PointPlane(const glm::vec3 &point, const glm::vec3 &plane, const glm::vec3 &normal)
+glm::vec3 boxAxis(const Engine::PhysicsModule::Box &box1, const Engine::PhysicsModule::Box &box2, int axis)
 {
-    // notice that normal is NOT normalized :)
-
-    // std::cout << "dist2PointPlane" << std::endl;
-    // std::cout << glm::to_string(point) << std::endl;
-    // std::cout << glm::to_string(plane) << std::endl;
-    // std::cout << glm::to_string(normal) << std::endl;
-
+    // 0-2: faces of box1, 3-5: faces of box2, 6-14: edge i of box1 x edge j of box2
+    if (axis < 3) return box1.axes[axis];
+    if (axis < 6) return box2.axes[axis - 3];
+    return glm::cross(box1.axes[(axis - 6) / 3], box2.axes[(axis - 6) % 3]);
+}
 
-    glm::vec3 v = point - plane;
-    GLfloat d2 = glm::dot(v, normal) * glm::dot(v, normal) / (glm::dot(v, v), glm::dot(normal, normal));
-    return d2;
+GLfloat boxOverlap(const Engine::PhysicsModule::Box &box1, const Engine::PhysicsModule::Box &box2,
+                   const glm::vec3 &axis)
+{
+    // projected half widths against the projected distance, negative: apart
+    GLfloat r1 = 0, r2 = 0;
+    for (int k=0; k<3; k++)
+    {
+        r1 += box1.half[k] * std::abs(glm::dot(box1.axes[k], axis));
+        r2 += box2.half[k] * std::abs(glm::dot(box2.axes[k], axis));
+    }
+    return r1 + r2 - std::abs(glm::dot(box1.center - box2.center, axis));
 }
 
-GLfloat dist2PointPoint(const glm::vec3 &p1, const glm::vec3 &p2)
+int clipPolygon(const glm::vec3 *in, int count, const glm::vec3 &normal, GLfloat offset, glm::vec3 *out)
 {
-    return glm::dot(p1-p2, p1-p2);
-}
\ No newline at end of file
+    // keeps the part with dot(p, normal) <= offset (Sutherland-Hodgman)
+    int kept = 0;
+    for (int i=0; i<count; i++)
+    {
+        const glm::vec3 &a = in[i], &b = in[(i + 1) % count];
+        GLfloat da = glm::dot(a, normal) - offset, db = glm::dot(b, normal) - offset;
+        if (da <= 0) out[kept++] = a;
+        if ((da < 0 && db > 0) || (da > 0 && db < 0)) out[kept++] = a + (b - a) * (da / (da - db));
+    }
+    return kept;
+}
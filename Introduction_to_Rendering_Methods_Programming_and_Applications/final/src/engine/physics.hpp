@@ -1,14 +1,30 @@
 #ifndef ENGINE_PHYSICS_HPP
 #define ENGINE_PHYSICS_HPP
 
+#include "engine/aabb_tree.hpp"
+#include "engine/barrier.hpp"
+#include "engine/body_store.hpp"
+#include "engine/broadphase.hpp"
+#include "engine/checkpoint.hpp"
+#include "engine/contact_store.hpp"
+#include "engine/disjoint_set.hpp"
+#include "engine/hard_spheres.hpp"
+#include "engine/kernels.hpp"
+#include "engine/octree.hpp"
+#include "engine/profiler.hpp"
+#include "engine/trajectory.hpp"
+#include "engine/transform_buffer.hpp"
+#include "engine/work_queue.hpp"
 #include "scene/scene.hpp"
 
+#include <atomic>
 #include <memory>
 #include <thread>
 #include <vector>
-#include <deque>
 #include <mutex>
+#include <condition_variable>
 #include <cmath>
+#include <string>
 
 namespace Engine
 {
@@ -17,9 +33,134 @@ class PhysicsModule: public std::enable_shared_from_this<PhysicsModule>
 {
 public:
     const GLfloat eps = (GLfloat)std::pow(10,-9); // avoid divided by zero
+    enum BroadPhase
+    {
+        BruteForce, // test every pair of objects
+        SpatialHash, // test only pairs sharing a cell of a uniform grid
+        AabbTree     // test pairs found in dynamic AABB trees, suits mixed sizes
+    };
+
+    enum Gravity
+    {
+        Exact,     // sum over every pair of objects
+        BarnesHut, // octree approximation, see GravityOctree
+        Attractors // only sources (see sourceRatio) pull test particles; sources feel
+                   // every body, so only test particle pairs are left out
+    };
+
+    enum Integrator
+    {
+        SemiImplicitEuler, // v += a dt, x += v dt; first order, one evaluation
+        Verlet,            // velocity Verlet (leapfrog); second order, one evaluation
+        RK4,               // classic Runge-Kutta; fourth order, four evaluations
+        Events             // hard spheres jumping from collision to collision, no gravity or
+                           // other forces; movable bodies must be spheres, see HardSphereSystem
+    };
+
+    enum ContactModel
+    {
+        Penalty, // spring force proportional to the sink, needs ~1 ms ticks
+        Impulse  // sequential impulses with warm starting, stable at 60 Hz
+    };
+
     struct Context
     {
-       
+        unsigned int threadNum = 1; // number of persistent worker threads, 0: none, phases run
+                                    // on the thread driving the module (one module per thread)
+        bool affinity = false;      // pin master and workers to their own cores
+        BroadPhase broadPhase = BroadPhase::SpatialHash;
+        GLfloat cellSize = 0;       // (m) 0: twice the median bounding radius
+        GLfloat treeMargin = 0;     // (m) AABB tree fat box growth, 0: a tenth of the median bounding radius
+        GLfloat neighborSkin = 0;   // (m) grid and tree: keep the candidate pairs as neighbour lists
+                                    // until a body has moved half of this, 0: rebuild every evaluation
+        Gravity gravity = Gravity::BarnesHut;
+        GLfloat theta = 0.5f;       // Barnes-Hut opening angle
+        GLfloat sourceRatio = 1e-3f; // attractors: bodies with at least this share of the
+                                     // heaviest mass are sources
+        Integrator integrator = Integrator::SemiImplicitEuler; // unless the scene names one
+        ContactModel contactModel = ContactModel::Impulse;
+        unsigned int solverIterations = 8; // impulse passes over the contacts per tick
+        GLfloat restitution = 0.2f;     // bounce, share of the approach velocity kept
+        GLfloat friction = 0.5f;        // Coulomb coefficient
+        GLfloat sweepFraction = 0.5f;   // spheres moving farther per tick than this share
+                                        // of their radius are swept, 0: off
+        unsigned int sweepSteps = 4;    // impacts followed per swept sphere and tick
+        Kernels::Isa kernels = Kernels::Isa::Auto; // SIMD width of the exact gravity and brute force
+        unsigned int maxSubSteps = 4;   // ticks run back to back when behind
+        unsigned int spinMargin = 200;  // (us) spin instead of sleeping this close to a tick
+        unsigned int grainSize = 0;     // events per chunk, 0: tuned from the last ticks
+        bool sleep = true;              // resting islands are skipped until touched
+        GLfloat sleepVelocity = 0.05f;  // (m/s) slower bodies count as resting
+        GLfloat sleepTime = 0.5f;       // (s) resting this long puts an island to sleep
+        std::string recordFile;         // poses of every published tick, see TrajectoryWriter
+        // only with PHYSICS_PROFILE, written at finish() if not empty
+        std::string profileCsv;
+        std::string profileTrace;       // chrome trace_event JSON
+        std::size_t profileHistory = 10000; // last ticks kept for the files
+    };
+
+    struct Stats
+    {
+        int awake;    // movable bodies simulated in the last tick
+        int sleeping;
+        int islands;  // awake islands
+    };
+
+    typedef void (PhysicsModule::*Phase)(unsigned int worker);
+
+    struct ForceAccumulator
+    {
+        AlignedVector<GLfloat> fx, fy, fz;
+    };
+
+    struct EventRange // chunk a worker is going through
+    {
+        int next, end;
+        char padding[56];
+    };
+
+    struct SolverContact // per tick state of a contact
+    {
+        glm::vec3 normal;  // unit
+        GLfloat mass;      // effective mass along any direction
+        GLfloat bounce;    // (m/s) separation velocity to reach
+        GLfloat push;      // (m/s) pseudo velocity that removes the overlap
+        GLfloat pushImpulse; // accumulated pseudo impulse, not kept between ticks
+    };
+
+    struct Box // oriented box of a cube body, rebuilt for every force evaluation
+    {
+        glm::vec3 center;
+        glm::vec3 axes[3]; // unit
+        GLfloat half[3];   // (m) half side along axes[k]
+    };
+
+    struct SeparatingAxis // axis that kept a pair of boxes apart last time
+    {
+        int other;
+        int axis;           // see boxAxis()
+        unsigned long tick; // last tick the pair was tested
+    };
+
+    struct RayHit
+    {
+        int body;          // index in the scene's bodies
+        GLfloat distance;  // along the ray, 0 if it starts inside
+        glm::vec3 point;
+        glm::vec3 normal;  // surface normal, against the ray if it starts inside
+    };
+
+    struct GravityReport // gravity mode against the exact sum, movable bodies
+    {
+        int sources;       // bodies that pull, all of them except in Attractors
+        double maxError;   // |F - F_exact| / |F_exact|
+        double meanError;
+    };
+
+    struct PhaseCost
+    {
+        Phase phase;
+        double cost; // (ns) per event, smoothed over ticks
     };
 
     class MasterThread
@@ -36,78 +177,231 @@ public:
     class WorkerThread
     {
     public:
-        WorkerThread(std::shared_ptr<PhysicsModule> physics);
-        template< class Function> void run(Function&& f);
+        WorkerThread(std::shared_ptr<PhysicsModule> physics, unsigned int id);
+        void start();
         bool join();
     private:
-        int id_;
+        void loop(PhysicsModule *physics);
+
+        unsigned int id_;
         std::weak_ptr<PhysicsModule> physics_;
         std::unique_ptr<std::thread> thread_;
     };
 
     PhysicsModule(unsigned int tick); // tick: ms
+    PhysicsModule(unsigned int tick, const Context &context);
     void init();
     ~PhysicsModule();
     void setScene(std::shared_ptr<Scene::Scene> scene);
     void start();
     void pause();
+    void resume();
+    bool paused();
+    void step(unsigned int ticks = 1); // pause and run ticks one by one
     void finish();
     void simulate();
+    void advance(unsigned int ticks); // run ticks on the caller, no pacing
+    unsigned long droppedTicks() const; // ticks skipped because simulation fell behind
+    std::shared_ptr<TransformBuffer> transforms(); // published once per tick
+    Stats stats() const;
+    void setIntegrator(Integrator integrator); // after setScene(), overrides the scene
+    static bool parseIntegrator(const std::string &name, Integrator &integrator);
+    bool testPair(int body1, int body2, ContactStore::Contact &contact); // narrow phase at the current state
+    // picking and gameplay queries at the current state, only while no tick is running
+    bool raycast(const glm::vec3 &origin, const glm::vec3 &direction, GLfloat maxDistance, RayHit &hit);
+    void queryRegion(const Aabb &region, std::vector<int> &bodies); // bounding box overlaps region
+    GravityReport gravityReport(); // O(N^2), only while no tick is running
+    // state to restart from, only while no tick is running; on a failed restore the
+    // module has no scene until the next setScene() or restore
+    bool saveCheckpoint(const std::string &path);
+    bool restoreCheckpoint(const std::string &path); // in place of setScene()
+    std::shared_ptr<Scene::Scene> scene() const;
+    unsigned long ticks() const; // simulated since setScene(), restored with the state
 private:
-    void pushEvents();
+    struct CheckpointState // what the checkpoint holds beside the member arrays
+    {
+        struct Scalars
+        {
+            std::uint64_t tickCount;
+            std::int32_t integrator;
+            std::int32_t accelerationsValid;
+            std::int32_t awake, sleeping, islands;
+            std::uint32_t tick; // (us) the state was simulated with
+            GLfloat G, g;  // of the scene
+        };
+
+        Scalars scalars;
+        std::string sceneIntegrator;
+        std::string appearances; // model and texture of every body, each ended by '\n'
+        std::vector<Scene::Body::PhysicalState> states; // scene bodies
+        std::vector<int> axisOffsets; // separatingAxes_[i]: axes[offsets[i], offsets[i+1])
+        std::vector<SeparatingAxis> axes;
+    };
+
+    void prepareScene(); // caches, buffers and first frame of scene_ and bodies_
+    void checkpointParts(Checkpoint &checkpoint, CheckpointState &state);
+    bool checkpointConsistent(const CheckpointState &state);
+
+    void runPhase(Phase phase);
+    void runPhase(Phase phase, int count);
+    int grainSize(PhaseCost &cost, int count);
     void workersJoin();
-    int getEvent();
-
-    void simulationUpdate();
-    void updateCollisionStates();
-    void updateNextStates();
-
-    glm::vec3 getGravity(std::shared_ptr<Scene::Object> object,
-                         std::shared_ptr<Scene::Scene> scene);
-    glm::vec3 getGravity(std::shared_ptr<Scene::Object> obj1,
-                         std::shared_ptr<Scene::Object> obj2);
-    glm::vec3 getCollisionForce(std::shared_ptr<Scene::Object> object,
-                                std::shared_ptr<Scene::Scene> scene);
-    glm::vec3 getCollisionForce(std::shared_ptr<Scene::Object> obj1,
-                                std::shared_ptr<Scene::Object> obj2);
-    glm::vec3 getVelocityChange(std::shared_ptr<Scene::Object> object,
-                                glm::vec3 F);
-    void testCollision(std::shared_ptr<Scene::Object> obj1,
-                       std::shared_ptr<Scene::Scene> scene);
-    bool testCollision(std::shared_ptr<Scene::Object> obj1,
-                       std::shared_ptr<Scene::Object> obj2);
-    bool collisionSphereSphere(std::shared_ptr<Scene::Object> obj1,
-                                 std::shared_ptr<Scene::Object> obj2);
-    bool collisionSphereCube(std::shared_ptr<Scene::Object> obj1,
-                               std::shared_ptr<Scene::Object> obj2);
-    bool collisionCubeCube(std::shared_ptr<Scene::Object> obj1,
-                             std::shared_ptr<Scene::Object> obj2);
-
-    void setCollisionSink(std::shared_ptr<Scene::Object> obj1,
-                            std::shared_ptr<Scene::Object> obj2,
-                            GLfloat sink);
-    void setCollisionNormal(std::shared_ptr<Scene::Object> obj1,
-                            std::shared_ptr<Scene::Object> obj2,
-                            glm::vec3 &normal);
+    int getEvent(unsigned int worker);
+
+    void simulationUpdate(unsigned int ticks = 1); // more than one only for Events
+    void evaluateForces(bool stage);
+    void integrateSemiImplicitEuler();
+    void integrateVerlet();
+    void integrateRK4();
+    void integrateEvents(unsigned int ticks);
+    void startEvents();
+    void publishTransforms();
+    void updateBoxes();
+    void updateBroadPhase();
+    void updateBoundingBoxes();
+    void updateTrees();
+    bool neighborsMoved(GLfloat distance);
+    void buildCandidates(const std::vector<SpatialHashGrid::Pair> &pairs);
+    void updateGravityTree();
+    void updateGravitySources();
+    void buildGravitySubtrees(unsigned int worker);
+    void updateCollisionStates(unsigned int worker);
+    void updateContacts();
+    void updateStageContacts();
+    void buildContactLists(const std::vector<ContactStore::Contact> &contacts);
+    void updateIslands();
+    void updateForces(unsigned int worker);
+    void updateAccelerations(unsigned int worker);
+    void solveContacts();
+    void solveIslands(unsigned int worker);
+    void prepareContact(ContactStore::Contact &contact, SolverContact &solver);
+    void warmStart(ContactStore::Contact &contact, const SolverContact &solver);
+    void solveContact(ContactStore::Contact &contact, const SolverContact &solver);
+    void solvePush(const ContactStore::Contact &contact, SolverContact &solver);
+    void applyImpulse(const ContactStore::Contact &contact, const glm::vec3 &impulse);
+    void applyPush(int body);
+    GLfloat inverseMass(int body);
+    void sweepFastBodies();
+    void sweepBody(int body);
+    bool sweepSphereSphere(int sphere, const glm::vec3 &start, const glm::vec3 &move,
+                           int other, const glm::vec3 &otherStart, const glm::vec3 &otherMove,
+                           GLfloat &time, glm::vec3 &normal);
+    bool sweepSphereCube(int sphere, const glm::vec3 &start, const glm::vec3 &move,
+                         int cube, const glm::vec3 &cubeStart, const glm::vec3 &cubeMove,
+                         GLfloat &time, glm::vec3 &normal);
+
+    Aabb getBoundingBox(int body);
+    Aabb getSweptBox(int body); // bounding box over the move since the start of the tick
+    bool raycastBody(int body, const glm::vec3 &origin, const glm::vec3 &direction, RayHit &hit);
+    void applyGravity(int body, ForceAccumulator &forces);
+    glm::vec3 getGravity(int s, int t);
+    glm::vec3 getSourceGravity(int body);
+    void applyCollisionForces(int body, ForceAccumulator &forces);
+    glm::vec3 getCollisionForce(const ContactStore::Contact &contact);
+    glm::vec3 getAcceleration(int body, glm::vec3 F);
+    void testCollision(int body, unsigned int worker);
+    bool testCollision(int body1, int body2, ContactStore::Contact &contact);
+    bool collisionSphereSphere(int sphere1, int sphere2, ContactStore::Contact &contact);
+    bool collisionSphereCube(int sphere, int cube, ContactStore::Contact &contact);
+    bool collisionCubeCube(int cube1, int cube2, ContactStore::Contact &contact);
+    Box getBox(int cube);
+    void setBoxFaceContact(const Box &reference, const Box &incident, const glm::vec3 &normal,
+                           ContactStore::Contact &contact);
+    void setBoxEdgeContact(const Box &box1, int edge1, const Box &box2, int edge2,
+                           const glm::vec3 &normal, ContactStore::Contact &contact);
+
+    void setCollisionSink(ContactStore::Contact &contact, GLfloat sink);
+    void setCollisionNormal(ContactStore::Contact &contact, glm::vec3 &normal);
 
     std::unique_ptr<MasterThread> master_;
     std::vector<std::unique_ptr<WorkerThread>> workers_;
-    std::mutex eventMutex_;
+    std::unique_ptr<Barrier> phaseBegin_;
+    std::unique_ptr<Barrier> phaseEnd_;
+    Phase phase_;
     std::mutex updateMutex_;
+    std::mutex pauseMutex_;
+    std::condition_variable pauseCond_; // master parks here while paused
 
     std::shared_ptr<Scene::Scene> scene_;
-    std::vector<Scene::Object::PhysicalState> objectNextStates_;
-    std::vector<std::vector<bool> > objectCollisionStates_;
-    std::vector<std::vector<GLfloat> > objectCollisionSink_;
-    std::vector<std::vector<glm::vec3> > objectCollisionNormal_;
-    std::deque<int> eventQueue_;
+    BodyStore bodies_;
+    ContactStore contacts_;
+    std::vector<std::vector<ContactStore::Contact>> workerContacts_; // found this tick
+    std::vector<std::vector<int>> workerHits_; // brute force: bounding spheres overlapping
+    std::vector<ContactStore::Contact> stageContacts_; // found at an intermediate RK4 state
+    const std::vector<ContactStore::Contact> *contactList_; // contacts the forces are taken from
+    std::vector<int> contactOffsets_; // contacts with body1 == i: contactRefs_[offsets[i], offsets[i+1])
+    std::vector<int> contactRefs_;
+
+    DisjointSet islands_;              // awake bodies joined by contacts
+    std::vector<GLfloat> restTime_;    // (s) time spent below sleepVelocity
+    std::vector<int> sleepIsland_;     // island a sleeping body fell asleep with
+    std::vector<GLfloat> islandRest_;  // by island root, shortest rest time
+    std::vector<std::uint8_t> islandSupported_; // by island root, touches a static body
+    std::vector<std::uint8_t> wakeIslands_;
+    std::vector<int> solverIslands_;  // by island root, index of its contact list
+    std::vector<int> solverOffsets_;  // contacts of island k: solverRefs_[offsets[k], offsets[k+1])
+    std::vector<int> solverRefs_;
+    std::vector<SolverContact> solverContacts_; // by contact index
+    std::vector<glm::vec3> pushVelocities_;     // split impulse, moves bodies without keeping speed
+    std::vector<glm::vec3> sweepStarts_;        // positions at the start of the tick
+    std::vector<int> sweepBodies_;              // fast spheres of this tick
+    std::vector<int> sweepOthers_;              // bodies a sub-step may hit
+    std::atomic<int> awakeBodies_;
+    std::atomic<int> sleepingBodies_;
+    std::atomic<int> awakeIslands_;
+    WorkQueue work_;
+    std::vector<EventRange> workerEvents_;
+    std::vector<PhaseCost> phaseCosts_;
+
+    SpatialHashGrid grid_;
+    std::vector<Aabb> boundingBoxes_;
+    DynamicAabbTree dynamicTree_;     // movable bodies, refitted as they move
+    DynamicAabbTree staticTree_;      // bodies that are not movable, built once
+    std::vector<int> treeProxies_;    // by body, leaf in its tree
+    std::vector<SpatialHashGrid::Pair> treePairs_;
+    std::vector<glm::vec3> neighborOrigins_; // positions the neighbour lists were built at
+    bool neighborsValid_;
+    std::vector<int> candidateOffsets_; // candidates j > i: [offsets[i], offsets[i+1])
+    std::vector<int> candidates_;
+    std::vector<Box> boxes_;          // by body, cubes only
+    std::vector<std::vector<SeparatingAxis>> separatingAxes_; // by lower body of a box pair
+
+    GravityOctree gravityTree_;
+    std::vector<glm::vec3> gravityPositions_;
+    std::vector<GLfloat> gravityMasses_;
+    std::vector<int> gravitySources_; // Attractors: bodies heavy enough to pull
+    std::vector<std::uint8_t> gravitySource_; // by body
+
+    std::vector<ForceAccumulator> workerForces_; // reduced by updateAccelerations
+
+    Integrator integrator_;
+    bool accelerationsValid_;       // ax/ay/az hold a(x) of the current positions
+    std::vector<glm::vec3> startPositions_; // RK4 state at the start of the tick
+    std::vector<glm::vec3> startVelocities_;
+    std::vector<glm::vec3> sumVelocities_;  // RK4 weighted sums of the stages
+    std::vector<glm::vec3> sumAccelerations_;
+    HardSphereSystem hardSpheres_;  // state of the Events integrator
+
+    std::shared_ptr<TransformBuffer> transforms_;
+    TrajectoryWriter recorder_;
+    unsigned long tickCount_;
+
+#if defined(PHYSICS_PROFILE)
+    Profiler profiler_;
+#endif
     
-    bool run_;
-    bool pause_;
+    Context context_;
+    Kernels kernels_; // picked from context_.kernels
+    std::atomic<bool> run_;
+    std::atomic<bool> workersRun_;
+    bool pause_;               // guarded by pauseMutex_
+    unsigned int stepRequests_; // guarded by pauseMutex_
+    std::atomic<unsigned long> droppedTicks_;
 
     GLfloat tick_; // (s) time passed between two simulation states
     unsigned int updateInterval_;
     unsigned int threadNum_; // number of threads
+    bool inlinePhases_;      // no workers, see Context::threadNum
 };
 
 }
@@ -0,0 +1,293 @@
+#include "engine/profiler.hpp"
+
+#if defined(PHYSICS_PROFILE)
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace Engine
+{
+
+const unsigned int Profiler::MaxWorkers;
+
+namespace
+{
+
+// times are kept in ns and written out in us
+double micros(std::uint64_t ns) { return (double)ns / 1000.0; }
+
+}
+
+Profiler::PhaseScope::PhaseScope(Profiler &profiler, Phase phase)
+    : profiler_{profiler}, phase_{phase}, begin_{profiler.now()}
+{
+    profiler_.phase_ = phase;
+    if (profiler_.current_.phaseTime[phase] == 0)
+    {
+        profiler_.current_.phaseBegin[phase] = (std::uint32_t)(begin_ - profiler_.current_.begin);
+    }
+}
+
+Profiler::PhaseScope::~PhaseScope()
+{
+    profiler_.current_.phaseTime[phase_] += (std::uint32_t)(profiler_.now() - begin_);
+}
+
+Profiler::WorkerScope::WorkerScope(Profiler &profiler, unsigned int worker)
+    : profiler_{profiler}, stats_{profiler.worker(worker)},
+      phase_{profiler.phase_}, begin_{profiler.now()}
+{
+    if (stats_.time[phase_] == 0)
+    {
+        stats_.begin[phase_] = (std::uint32_t)(begin_ - profiler_.current_.begin);
+    }
+}
+
+Profiler::WorkerScope::~WorkerScope()
+{
+    stats_.time[phase_] += (std::uint32_t)(profiler_.now() - begin_);
+}
+
+Profiler::Profiler()
+    : epoch_{std::chrono::steady_clock::now()}, phase_{Phase::BroadPhase},
+      head_{0}, tail_{0}, dropped_{0}, collected_{0}, workers_{0}, collecting_{false}
+{
+    std::memset(&current_, 0, sizeof(current_));
+}
+
+Profiler::~Profiler()
+{
+    stop();
+}
+
+void Profiler::start(unsigned int workers, std::size_t history)
+{
+    stop();
+
+    // the collector wakes every few ms, leave room for a slow wake up
+    std::size_t capacity = 1024;
+    while (capacity < history && capacity < 16384) capacity *= 2;
+    ring_.assign(capacity, TickStats{});
+    head_ = tail_ = 0;
+    dropped_ = 0;
+    history_.assign(std::max<std::size_t>(1, history), TickStats{});
+    collected_ = 0;
+    workers_ = std::min(workers, MaxWorkers);
+
+    collecting_ = true;
+    collector_ = std::thread(&Profiler::collect, this);
+}
+
+void Profiler::stop()
+{
+    if (!collector_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(collectorMutex_);
+        collecting_ = false;
+    }
+    collectorCond_.notify_all();
+    collector_.join();
+    while (drain());
+}
+
+void Profiler::beginTick(unsigned long tick)
+{
+    std::memset(&current_, 0, sizeof(current_));
+    current_.tick = tick;
+    current_.begin = now();
+}
+
+void Profiler::endTick()
+{
+    current_.time = (std::uint32_t)(now() - current_.begin);
+    if (ring_.empty()) return; // not started
+
+    // never wait for the collector, drop the tick if it is behind
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == ring_.size())
+    {
+        dropped_++;
+        return;
+    }
+    ring_[head & (ring_.size() - 1)] = current_;
+    head_.store(head + 1, std::memory_order_release);
+}
+
+Profiler::WorkerStats &Profiler::worker(unsigned int worker)
+{
+    return current_.workers[std::min(worker, MaxWorkers - 1)];
+}
+
+void Profiler::setBodies(int awake, int sleeping)
+{
+    current_.awake = (std::uint32_t)awake;
+    current_.sleeping = (std::uint32_t)sleeping;
+}
+
+std::uint64_t Profiler::now() const
+{
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch_).count();
+}
+
+unsigned long Profiler::dropped() const
+{
+    return dropped_;
+}
+
+void Profiler::collect()
+{
+    std::unique_lock<std::mutex> lock(collectorMutex_);
+    while (collecting_)
+    {
+        collectorCond_.wait_for(lock, std::chrono::milliseconds(5));
+        while (drain());
+    }
+}
+
+bool Profiler::drain() // run by collector
+{
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return false;
+
+    history_[collected_ % history_.size()] = ring_[tail & (ring_.size() - 1)];
+    collected_++;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+std::vector<Profiler::TickStats> Profiler::history() const
+{
+    std::vector<TickStats> ticks;
+    std::size_t count = std::min(collected_, history_.size());
+    for (std::size_t i=collected_-count; i<collected_; i++)
+    {
+        ticks.push_back(history_[i % history_.size()]);
+    }
+    return ticks;
+}
+
+const char *Profiler::phaseName(Phase phase)
+{
+    switch (phase)
+    {
+        case Phase::BroadPhase: return "broad_phase";
+        case Phase::NarrowPhase: return "narrow_phase";
+        case Phase::Contacts: return "contacts";
+        case Phase::GravityTree: return "gravity_tree";
+        case Phase::Forces: return "forces";
+        case Phase::Integration: return "integration";
+        case Phase::Solver: return "solver";
+        case Phase::Sweep: return "sweep";
+        case Phase::Publish: return "publish";
+        default: return "unknown";
+    }
+}
+
+bool Profiler::writeCsv(const std::string &path) const
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cerr << "[ERROR] Failed to open profile file: " << path << std::endl;
+        return false;
+    }
+
+    // one row per tick, times in us
+    out << "tick,begin,time";
+    for (int p=0; p<PhaseCount; p++) out << "," << phaseName((Phase)p);
+    out << ",awake,sleeping,pairs_tested,contacts_found";
+    for (unsigned int w=0; w<workers_; w++)
+    {
+        out << ",events_" << w << ",steals_" << w << ",busy_" << w;
+    }
+    out << "\n";
+
+    for (auto &stats : history())
+    {
+        std::uint64_t pairs = 0, contacts = 0;
+        for (unsigned int w=0; w<workers_; w++)
+        {
+            pairs += stats.workers[w].pairsTested;
+            contacts += stats.workers[w].contactsFound;
+        }
+
+        out << stats.tick << "," << micros(stats.begin) << "," << micros(stats.time);
+        for (int p=0; p<PhaseCount; p++) out << "," << micros(stats.phaseTime[p]);
+        out << "," << stats.awake << "," << stats.sleeping << "," << pairs << "," << contacts;
+        for (unsigned int w=0; w<workers_; w++)
+        {
+            auto &worker = stats.workers[w];
+            std::uint64_t busy = 0;
+            for (int p=0; p<PhaseCount; p++) busy += worker.time[p];
+            out << "," << worker.events << "," << worker.steals << "," << micros(busy);
+        }
+        out << "\n";
+    }
+    return true;
+}
+
+bool Profiler::writeTrace(const std::string &path) const
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cerr << "[ERROR] Failed to open trace file: " << path << std::endl;
+        return false;
+    }
+
+    // trace_event format, ts and dur in us; master is tid 0, worker i is tid i+1
+    auto event = [&out](const char *name, unsigned int tid, double ts, double dur)
+    {
+        out << ",\n{\"name\":\"" << name << "\",\"cat\":\"physics\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+            << tid << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+    };
+
+    out << std::fixed;
+    out.precision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"master\"}}";
+    for (unsigned int w=0; w<workers_; w++)
+    {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << w + 1
+            << ",\"args\":{\"name\":\"worker " << w << "\"}}";
+    }
+
+    for (auto &stats : history())
+    {
+        double begin = micros(stats.begin);
+        event("tick", 0, begin, micros(stats.time));
+        for (int p=0; p<PhaseCount; p++)
+        {
+            if (stats.phaseTime[p] == 0) continue;
+            event(phaseName((Phase)p), 0, begin + micros(stats.phaseBegin[p]), micros(stats.phaseTime[p]));
+        }
+
+        std::uint64_t pairs = 0, contacts = 0, events = 0, steals = 0;
+        for (unsigned int w=0; w<workers_; w++)
+        {
+            auto &worker = stats.workers[w];
+            for (int p=0; p<PhaseCount; p++)
+            {
+                if (worker.time[p] == 0) continue;
+                event(phaseName((Phase)p), w + 1, begin + micros(worker.begin[p]), micros(worker.time[p]));
+            }
+            pairs += worker.pairsTested;
+            contacts += worker.contactsFound;
+            events += worker.events;
+            steals += worker.steals;
+        }
+        out << ",\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":0,\"ts\":" << begin
+            << ",\"args\":{\"pairs_tested\":" << pairs << ",\"contacts_found\":" << contacts
+            << ",\"events\":" << events << ",\"steals\":" << steals
+            << ",\"awake\":" << stats.awake << ",\"sleeping\":" << stats.sleeping << "}}";
+    }
+    out << "\n]}\n";
+    return true;
+}
+
+} // namespace Engine
+
+#endif // PHYSICS_PROFILE
@@ -0,0 +1,155 @@
+#ifndef ENGINE_PROFILER_HPP
+#define ENGINE_PROFILER_HPP
+
+// per tick timings and counters of PhysicsModule, only built with
+// PHYSICS_PROFILE defined (cmake -DSampleCode_PROFILE=ON); otherwise the
+// PROFILE_* macros expand to nothing and the profiler does not exist
+
+#if defined(PHYSICS_PROFILE)
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Engine
+{
+
+class Profiler
+{
+public:
+    enum Phase
+    {
+        BroadPhase,
+        NarrowPhase,
+        Contacts,
+        GravityTree,
+        Forces,
+        Integration,
+        Solver,
+        Sweep,
+        Publish,
+        PhaseCount
+    };
+
+    static const unsigned int MaxWorkers = 16; // later workers count as the last one
+
+    struct WorkerStats
+    {
+        std::uint32_t begin[PhaseCount]; // (ns) from the start of the tick
+        std::uint32_t time[PhaseCount];  // (ns) spent in the phase
+        std::uint32_t events;            // events dequeued
+        std::uint32_t pairsTested;
+        std::uint32_t contactsFound;
+        std::uint32_t steals;            // chunks taken from other workers
+    };
+
+    struct TickStats
+    {
+        unsigned long tick;
+        std::uint64_t begin;             // (ns) from the start of the profiler
+        std::uint32_t time;              // (ns) whole tick
+        std::uint32_t phaseBegin[PhaseCount];
+        std::uint32_t phaseTime[PhaseCount];
+        std::uint32_t awake;             // bodies simulated
+        std::uint32_t sleeping;
+        WorkerStats workers[MaxWorkers];
+    };
+
+    class PhaseScope
+    {
+    public:
+        PhaseScope(Profiler &profiler, Phase phase);
+        ~PhaseScope();
+    private:
+        Profiler &profiler_;
+        Phase phase_;
+        std::uint64_t begin_;
+    };
+
+    class WorkerScope
+    {
+    public:
+        WorkerScope(Profiler &profiler, unsigned int worker);
+        ~WorkerScope();
+    private:
+        Profiler &profiler_;
+        WorkerStats &stats_;
+        Phase phase_;
+        std::uint64_t begin_;
+    };
+
+    Profiler();
+    ~Profiler();
+    Profiler(const Profiler &other) = delete;
+    Profiler &operator=(const Profiler &other) = delete;
+
+    // starts the collector thread which keeps the last `history` ticks
+    void start(unsigned int workers, std::size_t history);
+    void stop();
+
+    // master
+    void beginTick(unsigned long tick);
+    void endTick();
+    WorkerStats &worker(unsigned int worker);
+    void setBodies(int awake, int sleeping);
+    std::uint64_t now() const; // (ns) from the start of the profiler
+
+    // after stop()
+    bool writeCsv(const std::string &path) const;
+    bool writeTrace(const std::string &path) const; // chrome://tracing, Perfetto
+    unsigned long dropped() const; // ticks lost because the ring was full
+private:
+    static const char *phaseName(Phase phase);
+    void collect();
+    bool drain();
+    std::vector<TickStats> history() const; // oldest first
+
+    std::chrono::steady_clock::time_point epoch_;
+    TickStats current_; // filled by the master and, per slot, the workers
+    Phase phase_;       // read by workers while the phase runs
+
+    // single producer (master) single consumer (collector) ring
+    std::vector<TickStats> ring_; // capacity is a power of two
+    std::atomic<std::size_t> head_;
+    std::atomic<std::size_t> tail_;
+    std::atomic<unsigned long> dropped_;
+
+    std::vector<TickStats> history_; // circular, last history_.size() ticks
+    std::size_t collected_;
+    unsigned int workers_;
+
+    std::thread collector_;
+    std::mutex collectorMutex_;
+    std::condition_variable collectorCond_;
+    bool collecting_;
+};
+
+}
+
+#define PROFILE_TICK_BEGIN(profiler, tick) (profiler).beginTick(tick)
+#define PROFILE_TICK_END(profiler) (profiler).endTick()
+#define PROFILE_PHASE(profiler, phase) \
+    Engine::Profiler::PhaseScope profilePhase_(profiler, Engine::Profiler::phase)
+#define PROFILE_WORKER(profiler, id) \
+    Engine::Profiler::WorkerScope profileWorker_(profiler, id)
+#define PROFILE_BODIES(profiler, awake, sleeping) (profiler).setBodies(awake, sleeping)
+#define PROFILE_COUNT(profiler, id, counter, n) \
+    ((profiler).worker(id).counter += (std::uint32_t)(n))
+
+#else
+
+#define PROFILE_TICK_BEGIN(profiler, tick) ((void)0)
+#define PROFILE_TICK_END(profiler) ((void)0)
+#define PROFILE_PHASE(profiler, phase) ((void)0)
+#define PROFILE_WORKER(profiler, id) ((void)0)
+#define PROFILE_BODIES(profiler, awake, sleeping) ((void)0)
+#define PROFILE_COUNT(profiler, id, counter, n) ((void)0)
+
+#endif // PHYSICS_PROFILE
+
+#endif // ENGINE_PROFILER_HPP
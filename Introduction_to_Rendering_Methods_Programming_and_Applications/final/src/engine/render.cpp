@@ -5,6 +5,7 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <vector>
@@ -119,10 +120,99 @@ bool RenderModule::initializeContext(std::array<int, 2> &openglVersion,
     return true;
 }
 
-void RenderModule::loop(std::shared_ptr<Scene::Scene> &scene)
+void RenderModule::setScene(std::shared_ptr<Scene::Scene> &scene,
+                            std::shared_ptr<TransformBuffer> transforms)
+{
+    transforms_ = transforms;
+
+    // render resources are only created here, the scene is pure physics
+    objects_.clear();
+    for (int i=0; i<(int)scene->bodies().size(); i++)
+    {
+        auto &appearance = scene->appearances()[i];
+        objects_.emplace_back(new Scene::Object(scene->bodies()[i],
+                                                appearance.model.c_str(),
+                                                appearance.texture.c_str()));
+    }
+    models_.assign(objects_.size(), glm::mat4{1});
+}
+
+void RenderModule::setInterpolation(bool interpolation)
+{
+    interpolation_ = interpolation;
+}
+
+void RenderModule::setReplay(std::shared_ptr<TrajectoryReader> replay)
+{
+    if (replay && replay->bodies() != (int)models_.size())
+    {
+        std::cerr << "[ERROR] Recording has " << replay->bodies() << " bodies, the scene "
+                  << models_.size() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    replay_ = replay;
+    replayTick_ = replay_ && replay_->frames() > 0 ? (double)replay_->tick(0) : 0;
+    replayClock_ = -1;
+    replayPaused_ = false;
+}
+
+void RenderModule::updateReplay()
+{
+    std::size_t frames = replay_->frames();
+    if (frames == 0) return;
+
+    // recorded time runs at wall clock speed, scrubbing eight times as fast
+    double now = glfwGetTime();
+    double elapsed = replayClock_ < 0 ? 0 : now - replayClock_;
+    replayClock_ = now;
+
+    bool pauseKey = window_->keyPressed(GLFW_KEY_SPACE);
+    if (pauseKey && !pauseKeyDown_) replayPaused_ = !replayPaused_;
+    pauseKeyDown_ = pauseKey;
+
+    double speed = replayPaused_ ? 0 : 1;
+    if (window_->keyPressed(GLFW_KEY_RIGHT)) speed = 8;
+    if (window_->keyPressed(GLFW_KEY_LEFT)) speed = -8;
+    double first = (double)replay_->tick(0), last = (double)replay_->tick(frames - 1);
+    if (window_->keyPressed(GLFW_KEY_HOME)) replayTick_ = first;
+    replayTick_ = std::min(std::max(replayTick_ + speed * elapsed / (double)replay_->tick(), first), last);
+
+    // frames are found by tick, those of the events integrator skip ticks;
+    // bodies are only translated and scaled, blending the matrices is exact
+    std::size_t frame = replay_->find((unsigned long)replayTick_);
+    std::size_t next = std::min(frame + 1, frames - 1);
+    double span = (double)replay_->tick(next) - (double)replay_->tick(frame);
+    GLfloat alpha = span > 0 ? (GLfloat)((replayTick_ - (double)replay_->tick(frame)) / span) : 0;
+    for (std::size_t i=0; i<models_.size(); i++)
+    {
+        glm::mat4 m0 = replay_->model(frame, (int)i);
+        glm::mat4 m1 = replay_->model(next, (int)i);
+        models_[i] = m0 + (m1 - m0) * alpha;
+    }
+}
+
+void RenderModule::loop()
 {
     while (window_->updateFrame())
     {
+        if (replay_)
+        {
+            updateReplay();
+        }
+        else
+        {
+            // bodies belong to the physics thread, draw its latest published tick
+            transforms_->update();
+            if (transforms_->current().models.size() == models_.size())
+            {
+                GLfloat alpha = interpolation_ ? transforms_->alpha(TransformBuffer::Clock::now()) : 1;
+                for (std::size_t i=0; i<models_.size(); i++)
+                {
+                    models_[i] = transforms_->model((int)i, alpha);
+                }
+            }
+        }
+
         // render depth of scene to texture (from light's perspective)
         glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
         // glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -136,9 +226,10 @@ void RenderModule::loop(std::shared_ptr<Scene::Scene> &scene)
 
         glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO_);
         glClear(GL_DEPTH_BUFFER_BIT);
-        for (auto &object : scene->objects())
+        for (std::size_t i=0; i<objects_.size(); i++)
         {
-            depthShader_->setMat4("model", object->model());
+            auto &object = objects_[i];
+            depthShader_->setMat4("model", models_[i]);
 
             object->bind();
             glDrawElements(GL_TRIANGLES, object->indicesCount(), GL_UNSIGNED_INT, 0);
@@ -176,10 +267,11 @@ void RenderModule::loop(std::shared_ptr<Scene::Scene> &scene)
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, depthMap_);
 
-        for (auto &object : scene->objects())
+        for (std::size_t i=0; i<objects_.size(); i++)
         {
-            glm::mat4 mvp{projection * view * object->model()};
-            shader_->setMat4("model", object->model());
+            auto &object = objects_[i];
+            glm::mat4 mvp{projection * view * models_[i]};
+            shader_->setMat4("model", models_[i]);
 
             object->bind();
             glDrawElements(GL_TRIANGLES, object->indicesCount(), GL_UNSIGNED_INT, 0);
@@ -3,7 +3,10 @@
 
 #include "opengl/window.hpp"
 #include "opengl/shader.hpp"
+#include "engine/trajectory.hpp"
+#include "engine/transform_buffer.hpp"
 #include "scene/scene.hpp"
+#include "scene/object.hpp"
 
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
@@ -28,11 +31,18 @@ public:
     RenderModule(std::array<int, 2> &openglVersion,
                  std::array<int, 2> &windowSize,
                  std::string &windowTitle);
-    void loop(std::shared_ptr<Scene::Scene> &scene);
+    void setScene(std::shared_ptr<Scene::Scene> &scene,
+                  std::shared_ptr<TransformBuffer> transforms);
+    void setInterpolation(bool interpolation); // blend the last two physics ticks
+    // draw a recording instead of what physics publishes, after setScene();
+    // space pauses, left and right arrows scrub, home goes back to the start
+    void setReplay(std::shared_ptr<TrajectoryReader> replay);
+    void loop();
 private:
     bool initializeContext(std::array<int, 2> &openglVersion,
                            std::array<int, 2> &windowSize,
                            std::string &windowTitle);
+    void updateReplay();
 
     std::unique_ptr<OpenGL::Window> window_;
     std::unique_ptr<OpenGL::Shader> shader_;
@@ -40,6 +50,16 @@ private:
     std::unique_ptr<OpenGL::Shader> debugShader_;
 
     std::vector<Light> lights_;
+    std::vector<std::unique_ptr<Scene::Object>> objects_;
+    std::shared_ptr<TransformBuffer> transforms_;
+    std::vector<glm::mat4> models_; // transforms of this frame
+    bool interpolation_ = true;
+
+    std::shared_ptr<TrajectoryReader> replay_;
+    double replayTick_ = 0;   // playback position, fractional between frames
+    double replayClock_ = -1; // glfwGetTime() of the last frame, -1: none yet
+    bool replayPaused_ = false;
+    bool pauseKeyDown_ = false;
 
     unsigned int depthMapFBO_;
     unsigned int depthMap_;
@@ -0,0 +1,276 @@
+#include "engine/trajectory.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Engine
+{
+
+namespace
+{
+
+const std::size_t HeaderSize = 16;
+const std::size_t ChunkHeaderSize = 8;
+const std::size_t TrailerSize = 16;
+
+std::size_t scalesSize(std::uint32_t bodies)
+{
+    return (bodies * 3 * sizeof(float) + 7) / 8 * 8;
+}
+
+std::size_t frameSize(std::uint32_t bodies)
+{
+    return sizeof(std::uint64_t) + bodies * sizeof(Pose);
+}
+
+template<class T>
+void put(std::vector<char> &buffer, std::size_t offset, const T &value)
+{
+    std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+template<class T>
+T get(const char *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+}
+
+TrajectoryWriter::TrajectoryWriter()
+    : bodies_{0}, chunkFrames_{0}, chunkCount_{0}, offset_{0}
+{}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    close();
+}
+
+bool TrajectoryWriter::open(const std::string &path, const std::vector<glm::vec3> &scales, GLfloat tick,
+                            unsigned int chunkFrames)
+{
+    close();
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_)
+    {
+        std::cerr << "[ERROR] Failed to open trajectory file: " << path << std::endl;
+        return false;
+    }
+
+    bodies_ = (std::uint32_t)scales.size();
+    chunkFrames_ = std::max(1u, chunkFrames);
+    chunkCount_ = 0;
+    table_.clear();
+
+    std::vector<char> header(HeaderSize + scalesSize(bodies_), 0);
+    std::memcpy(header.data(), "TRJ1", 4);
+    put(header, 4, bodies_);
+    put(header, 8, chunkFrames_);
+    put(header, 12, (float)tick);
+    for (std::uint32_t i=0; i<bodies_; i++)
+    {
+        std::memcpy(header.data() + HeaderSize + i * 3 * sizeof(float), &scales[i][0], 3 * sizeof(float));
+    }
+    file_.write(header.data(), header.size());
+    offset_ = header.size();
+
+    chunk_.assign(ChunkHeaderSize + chunkFrames_ * frameSize(bodies_), 0);
+    std::memcpy(chunk_.data(), "CHNK", 4);
+    return true;
+}
+
+bool TrajectoryWriter::recording() const { return file_.is_open(); }
+
+void TrajectoryWriter::append(unsigned long tick, const BodyStore &bodies)
+{
+    if (!file_.is_open()) return;
+
+    // frames collect in memory and go out a chunk at a time
+    std::size_t offset = ChunkHeaderSize + chunkCount_ * frameSize(bodies_);
+    table_.push_back(offset_ + offset);
+    put(chunk_, offset, (std::uint64_t)tick);
+    Pose *poses = reinterpret_cast<Pose*>(chunk_.data() + offset + sizeof(std::uint64_t));
+    for (std::uint32_t i=0; i<bodies_; i++)
+    {
+        poses[i] = Pose{{bodies.px[i], bodies.py[i], bodies.pz[i]}, {0, 0, 0, 1}};
+    }
+
+    if (++chunkCount_ == chunkFrames_) writeChunk();
+}
+
+void TrajectoryWriter::close()
+{
+    if (!file_.is_open()) return;
+
+    if (chunkCount_ > 0) writeChunk();
+    std::uint64_t tableOffset = offset_;
+    file_.write(reinterpret_cast<const char*>(table_.data()), table_.size() * sizeof(std::uint64_t));
+    file_.write(reinterpret_cast<const char*>(&tableOffset), sizeof(tableOffset));
+    file_.write("TRJTABLE", 8);
+    file_.close();
+    if (!file_)
+    {
+        std::cerr << "[ERROR] Failed to write trajectory file" << std::endl;
+    }
+}
+
+void TrajectoryWriter::writeChunk()
+{
+    std::size_t size = ChunkHeaderSize + chunkCount_ * frameSize(bodies_);
+    put(chunk_, 4, chunkCount_);
+    file_.write(chunk_.data(), size);
+    offset_ += size;
+    chunkCount_ = 0;
+}
+
+TrajectoryReader::TrajectoryReader()
+    : data_{nullptr}, size_{0}, bodies_{0}, tick_{0}, scales_{nullptr}
+{}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    close();
+}
+
+bool TrajectoryReader::open(const std::string &path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0 || (std::size_t)status.st_size < HeaderSize)
+    {
+        std::cerr << "[ERROR] Failed to open trajectory file: " << path << std::endl;
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    size_ = (std::size_t)status.st_size;
+    void *data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        std::cerr << "[ERROR] Failed to map trajectory file: " << path << std::endl;
+        size_ = 0;
+        return false;
+    }
+    data_ = static_cast<const char*>(data);
+
+    bodies_ = get<std::uint32_t>(data_ + 4);
+    tick_ = get<float>(data_ + 12);
+    scales_ = reinterpret_cast<const float*>(data_ + HeaderSize);
+    if (std::memcmp(data_, "TRJ1", 4) != 0 || size_ < HeaderSize + scalesSize(bodies_))
+    {
+        std::cerr << "[ERROR] Not a trajectory file: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    // the table written at close, or the chunks walked if it is missing
+    std::size_t first = HeaderSize + scalesSize(bodies_); // where frames may start
+    if (size_ >= first + TrailerSize && std::memcmp(data_ + size_ - 8, "TRJTABLE", 8) == 0)
+    {
+        std::uint64_t tableOffset = get<std::uint64_t>(data_ + size_ - TrailerSize);
+        if (tableOffset >= first && tableOffset <= size_ - TrailerSize)
+        {
+            table_.resize((size_ - TrailerSize - tableOffset) / sizeof(std::uint64_t));
+            std::memcpy(table_.data(), data_ + tableOffset, table_.size() * sizeof(std::uint64_t));
+        }
+        // every frame has to lie between the header and the table
+        bool valid = !table_.empty() || tableOffset == first;
+        for (std::uint64_t offset : table_)
+        {
+            if (offset < first || offset > tableOffset || tableOffset - offset < frameSize(bodies_)) valid = false;
+        }
+        if (valid) return true;
+        table_.clear();
+        std::cerr << "[WARNING] Trajectory frame table is damaged, rebuilding it: " << path << std::endl;
+        return index();
+    }
+    std::cerr << "[WARNING] Trajectory file has no frame table, rebuilding it: " << path << std::endl;
+    return index();
+}
+
+void TrajectoryReader::close()
+{
+    if (data_) munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    bodies_ = 0;
+    scales_ = nullptr;
+    table_.clear();
+}
+
+int TrajectoryReader::bodies() const { return (int)bodies_; }
+
+std::size_t TrajectoryReader::frames() const { return table_.size(); }
+
+GLfloat TrajectoryReader::tick() const { return tick_; }
+
+glm::vec3 TrajectoryReader::scale(int body) const
+{
+    return glm::vec3(scales_[body * 3], scales_[body * 3 + 1], scales_[body * 3 + 2]);
+}
+
+unsigned long TrajectoryReader::tick(std::size_t frame) const
+{
+    return (unsigned long)get<std::uint64_t>(data_ + table_[frame]);
+}
+
+const Pose *TrajectoryReader::poses(std::size_t frame) const
+{
+    return reinterpret_cast<const Pose*>(data_ + table_[frame] + sizeof(std::uint64_t));
+}
+
+glm::mat4 TrajectoryReader::model(std::size_t frame, int body) const
+{
+    // same order as Scene::Body: scaled, then rotated, then moved
+    const Pose &pose = poses(frame)[body];
+    glm::quat orientation(pose.orientation[3], pose.orientation[0], pose.orientation[1], pose.orientation[2]);
+    glm::mat4 T = glm::translate(glm::mat4{1}, glm::vec3(pose.position[0], pose.position[1], pose.position[2]));
+    return glm::scale(T * glm::mat4_cast(orientation), scale(body));
+}
+
+std::size_t TrajectoryReader::find(unsigned long tick) const
+{
+    // ticks only grow along the file
+    std::size_t lo = 0, hi = table_.size();
+    while (lo + 1 < hi)
+    {
+        std::size_t mid = (lo + hi) / 2;
+        if (this->tick(mid) <= tick) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool TrajectoryReader::index()
+{
+    // a chunk cut off in the middle keeps the frames that made it
+    std::size_t offset = HeaderSize + scalesSize(bodies_);
+    std::size_t frame = frameSize(bodies_);
+    while (offset + ChunkHeaderSize <= size_ && std::memcmp(data_ + offset, "CHNK", 4) == 0)
+    {
+        std::uint32_t count = get<std::uint32_t>(data_ + offset + 4);
+        std::size_t first = offset + ChunkHeaderSize;
+        for (std::uint32_t k=0; k<count && first + (k + 1) * frame <= size_; k++)
+        {
+            table_.push_back(first + k * frame);
+        }
+        offset = first + count * frame;
+    }
+    return true;
+}
+
+} // namespace Engine
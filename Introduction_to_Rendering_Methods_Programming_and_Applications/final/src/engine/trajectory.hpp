@@ -0,0 +1,89 @@
+#ifndef ENGINE_TRAJECTORY_HPP
+#define ENGINE_TRAJECTORY_HPP
+
+#include "engine/body_store.hpp"
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+
+// recorded body poses, one frame per published tick, in a file that is only
+// ever appended to:
+//   header  char[4] "TRJ1", uint32 bodies, uint32 frames per chunk, float tick (s)
+//           float[3] scale per body, padded to 8 bytes
+//   chunk   char[4] "CHNK", uint32 frames, then the frames:
+//           uint64 tick, Pose per body
+//   table   uint64 offset of every frame, then uint64 offset of the table and
+//           char[8] "TRJTABLE"; written by close(), a file without it (the
+//           recording was cut off) is indexed by walking the chunks
+// in native byte order; poses are 4 byte aligned so they are read in place
+struct Pose
+{
+    float position[3];
+    float orientation[4]; // quaternion x y z w
+};
+
+class TrajectoryWriter
+{
+public:
+    TrajectoryWriter();
+    ~TrajectoryWriter();
+
+    // scales: of the bodies' unit models, see Scene::Body::PhysicalState::radius
+    bool open(const std::string &path, const std::vector<glm::vec3> &scales, GLfloat tick,
+              unsigned int chunkFrames = 64);
+    bool recording() const;
+    void append(unsigned long tick, const BodyStore &bodies); // bodies never rotate
+    void close(); // writes the last chunk and the frame table
+private:
+    void writeChunk();
+
+    std::ofstream file_;
+    std::uint32_t bodies_;
+    std::uint32_t chunkFrames_;
+    std::uint32_t chunkCount_;      // frames in chunk_
+    std::uint64_t offset_;          // end of the file
+    std::vector<char> chunk_;       // header and frames of the chunk being filled
+    std::vector<std::uint64_t> table_;
+};
+
+// memory maps a recording, frames are read where they lie in the file
+class TrajectoryReader
+{
+public:
+    TrajectoryReader();
+    ~TrajectoryReader();
+    TrajectoryReader(const TrajectoryReader &other) = delete;
+    TrajectoryReader &operator=(const TrajectoryReader &other) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    int bodies() const;
+    std::size_t frames() const;
+    GLfloat tick() const; // (s)
+    glm::vec3 scale(int body) const;
+    unsigned long tick(std::size_t frame) const;
+    const Pose *poses(std::size_t frame) const; // bodies() of them, valid until close()
+    glm::mat4 model(std::size_t frame, int body) const;
+    std::size_t find(unsigned long tick) const; // last frame at or before tick, 0 if none
+private:
+    bool index(); // table_ from the chunks
+
+    const char *data_;
+    std::size_t size_;
+    std::uint32_t bodies_;
+    GLfloat tick_;
+    const float *scales_;
+    std::vector<std::uint64_t> table_;
+};
+
+}
+
+#endif // ENGINE_TRAJECTORY_HPP
@@ -0,0 +1,93 @@
+#include "engine/transform_buffer.hpp"
+
+#include <algorithm>
+
+namespace Engine
+{
+
+const unsigned int TransformBuffer::Fresh;
+
+TransformBuffer::TransformBuffer()
+    : middle_{1}, back_{0}, front_{2}
+{}
+
+void TransformBuffer::resize(int bodies)
+{
+    middle_ = 1;
+    back_ = 0;
+    front_ = 2;
+    for (auto &frame : frames_)
+    {
+        frame.tick = 0;
+        frame.models.assign(bodies, glm::mat4{1});
+    }
+    // nothing read yet, the first frame must not be blended with these
+    frames_[front_].models.clear();
+    previous_ = frames_[front_];
+}
+
+TransformBuffer::Frame &TransformBuffer::back()
+{
+    return frames_[back_];
+}
+
+void TransformBuffer::publish()
+{
+    // hand the back frame over and take whatever the shared one was, an
+    // unread frame is simply overwritten by the next publish
+    unsigned int old = middle_.exchange(back_ | Fresh, std::memory_order_acq_rel);
+    back_ = old & ~Fresh;
+}
+
+bool TransformBuffer::update()
+{
+    if (!(middle_.load(std::memory_order_acquire) & Fresh)) return false;
+
+    // keep the frame being replaced for interpolation
+    std::swap(previous_.models, frames_[front_].models);
+    previous_.tick = frames_[front_].tick;
+    previous_.time = frames_[front_].time;
+
+    unsigned int old = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = old & ~Fresh;
+
+    // frames were skipped or this is the first one, nothing to blend from
+    if (frames_[front_].tick != previous_.tick + 1 ||
+        frames_[front_].models.size() != previous_.models.size())
+    {
+        previous_.models = frames_[front_].models;
+        previous_.tick = frames_[front_].tick;
+        previous_.time = frames_[front_].time;
+    }
+    return true;
+}
+
+const TransformBuffer::Frame &TransformBuffer::current() const
+{
+    return frames_[front_];
+}
+
+const TransformBuffer::Frame &TransformBuffer::previous() const
+{
+    return previous_;
+}
+
+GLfloat TransformBuffer::alpha(Clock::time_point now) const
+{
+    // render one tick behind, moving from previous to current as long as
+    // the tick between them took
+    std::chrono::duration<GLfloat> tick = current().time - previous_.time;
+    std::chrono::duration<GLfloat> elapsed = now - current().time;
+    if (tick.count() <= 0) return 1;
+    return std::min(std::max(elapsed.count() / tick.count(), (GLfloat)0), (GLfloat)1);
+}
+
+glm::mat4 TransformBuffer::model(int body, GLfloat alpha) const
+{
+    // bodies are only translated and scaled, blending the matrices is exact
+    const glm::mat4 &m0 = previous_.models[body];
+    const glm::mat4 &m1 = current().models[body];
+    return m0 + (m1 - m0) * alpha;
+}
+
+} // namespace Engine
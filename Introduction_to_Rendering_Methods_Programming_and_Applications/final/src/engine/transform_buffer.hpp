@@ -0,0 +1,55 @@
+#ifndef ENGINE_TRANSFORM_BUFFER_HPP
+#define ENGINE_TRANSFORM_BUFFER_HPP
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+namespace Engine
+{
+
+// lock-free triple buffer of per body model matrices, physics publishes one
+// frame per tick and render takes the newest one without ever blocking;
+// one writer thread and one reader thread
+class TransformBuffer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Frame
+    {
+        unsigned long tick = 0;
+        Clock::time_point time;
+        std::vector<glm::mat4> models; // in the order of Scene::bodies()
+    };
+
+    TransformBuffer();
+    void resize(int bodies); // not thread safe, call before the threads run
+
+    // writer
+    Frame &back();
+    void publish();
+
+    // reader, update() returns false if nothing was published since last call;
+    // current() is empty until the first frame has been taken
+    bool update();
+    const Frame &current() const;
+    const Frame &previous() const;
+    GLfloat alpha(Clock::time_point now) const; // progress from previous to current
+    glm::mat4 model(int body, GLfloat alpha) const;
+private:
+    static const unsigned int Fresh = 4; // set in middle_ when it holds an unread frame
+
+    Frame frames_[3];
+    Frame previous_;
+    std::atomic<unsigned int> middle_; // index of the shared frame | Fresh
+    unsigned int back_;  // owned by the writer
+    unsigned int front_; // owned by the reader
+};
+
+}
+
+#endif // ENGINE_TRANSFORM_BUFFER_HPP
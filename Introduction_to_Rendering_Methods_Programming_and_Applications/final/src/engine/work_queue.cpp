@@ -0,0 +1,91 @@
+#include "engine/work_queue.hpp"
+
+#include <algorithm>
+
+namespace Engine
+{
+
+WorkQueue::WorkQueue()
+    : workers_{0}, grain_{1}
+{}
+
+void WorkQueue::resize(unsigned int workers)
+{
+    ranges_.reset(new Range[workers]);
+    workers_ = workers;
+    reset(0, 1);
+}
+
+void WorkQueue::reset(int count, int grain)
+{
+    grain_ = (std::uint32_t)std::max(1, grain);
+    for (unsigned int w=0; w<workers_; w++)
+    {
+        std::uint32_t begin = (std::uint32_t)((std::uint64_t)count * w / workers_);
+        std::uint32_t end = (std::uint32_t)((std::uint64_t)count * (w + 1) / workers_);
+        ranges_[w].bounds.store(pack(begin, end), std::memory_order_relaxed);
+    }
+    // published to the workers by the phase barrier
+}
+
+bool WorkQueue::pop(unsigned int worker, int &begin, int &end, bool &stolen)
+{
+    stolen = false;
+    Range &own = ranges_[worker];
+    if (take(own, begin, end)) return true;
+
+    for (unsigned int k=1; k<workers_; k++)
+    {
+        if (steal(ranges_[(worker + k) % workers_], own))
+        {
+            stolen = true;
+            if (take(own, begin, end)) return true;
+        }
+    }
+    return false;
+}
+
+std::uint64_t WorkQueue::pack(std::uint32_t begin, std::uint32_t end)
+{
+    return (std::uint64_t)begin << 32 | end;
+}
+
+bool WorkQueue::take(Range &range, int &begin, int &end)
+{
+    std::uint64_t bounds = range.bounds.load(std::memory_order_acquire);
+    while (true)
+    {
+        std::uint32_t b = (std::uint32_t)(bounds >> 32), e = (std::uint32_t)bounds;
+        if (b >= e) return false;
+
+        std::uint32_t next = std::min(e, b + grain_);
+        if (range.bounds.compare_exchange_weak(bounds, pack(next, e), std::memory_order_acq_rel))
+        {
+            begin = (int)b;
+            end = (int)next;
+            return true;
+        }
+    }
+}
+
+bool WorkQueue::steal(Range &victim, Range &own)
+{
+    // indices are handed out once per phase, so a range value never repeats
+    // and the compare exchange can't be fooled by ABA
+    std::uint64_t bounds = victim.bounds.load(std::memory_order_acquire);
+    while (true)
+    {
+        std::uint32_t b = (std::uint32_t)(bounds >> 32), e = (std::uint32_t)bounds;
+        if (b >= e) return false;
+
+        std::uint32_t middle = e - b <= grain_ ? b : b + (e - b) / 2;
+        if (victim.bounds.compare_exchange_weak(bounds, pack(b, middle), std::memory_order_acq_rel))
+        {
+            // own is empty and only its owner refills it
+            own.bounds.store(pack(middle, e), std::memory_order_release);
+            return true;
+        }
+    }
+}
+
+} // namespace Engine
@@ -0,0 +1,43 @@
+#ifndef ENGINE_WORK_QUEUE_HPP
+#define ENGINE_WORK_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace Engine
+{
+
+// indices [0, count) of a phase split into one contiguous range per worker;
+// a worker takes grain sized chunks from the front of its own range and,
+// once that is empty, steals the back half of another worker's range
+class WorkQueue
+{
+public:
+    WorkQueue();
+    void resize(unsigned int workers);
+
+    // master, only while no worker is popping
+    void reset(int count, int grain);
+
+    // worker, false when every range is empty
+    bool pop(unsigned int worker, int &begin, int &end, bool &stolen);
+private:
+    struct Range
+    {
+        std::atomic<std::uint64_t> bounds; // begin << 32 | end
+        char padding[56];                  // own cache line, workers hammer their own range
+    };
+
+    static std::uint64_t pack(std::uint32_t begin, std::uint32_t end);
+    bool take(Range &range, int &begin, int &end);
+    bool steal(Range &victim, Range &own);
+
+    std::unique_ptr<Range[]> ranges_;
+    unsigned int workers_;
+    std::uint32_t grain_;
+};
+
+}
+
+#endif // ENGINE_WORK_QUEUE_HPP
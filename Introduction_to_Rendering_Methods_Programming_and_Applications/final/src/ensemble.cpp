@@ -0,0 +1,326 @@
+#include "engine/physics.hpp"
+#include "scene/scene.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// many variants of one scene, each simulated start to end by one thread of
+// a pool with a single threaded PhysicsModule, states streamed to a binary
+// file as the variants produce them
+//
+// spec file, one directive per line, lines starting with # are skipped:
+//   variants N                number of variants (100)
+//   seed S                    variant k draws from seed + k, whichever thread runs it (1)
+//   velocity BODY DIST x y z  (m/s) added to the velocity
+//   position BODY DIST x y z  (m) added to the position
+//   mass BODY DIST r          mass times 1 + r
+// BODY: id of the body in the scene or * for every movable body
+// DIST: uniform, drawn from [-x, x] per variant, body and axis; linear, from
+//       -x for the first variant to x for the last
+//
+// output, native byte order:
+//   header  char[4] "ENS1", uint32 bodies, uint32 variants, float tick (s)
+//   record  uint32 variant, uint32 tick, uint32 kind, then
+//           kind 0: float mass per body, once per variant before its states
+//           kind 1: float x y z vx vy vz per body
+// records of different variants interleave, each variant's are in order
+
+struct Perturbation
+{
+    enum Quantity
+    {
+        Velocity,
+        Position,
+        Mass
+    };
+
+    Quantity quantity;
+    int body;        // -1: every movable body
+    bool linear;     // false: uniform
+    glm::vec3 range; // mass: relative, in x
+};
+
+struct Spec
+{
+    std::uint32_t variants = 100;
+    unsigned long seed = 1;
+    std::vector<Perturbation> perturbations;
+};
+
+struct RecordHeader
+{
+    std::uint32_t variant;
+    std::uint32_t tick;
+    std::uint32_t kind;
+};
+
+void usage(const char *program)
+{
+    std::cerr << "Expect: " << program << " [scene file] [spec file] [options]\n"
+              << "    --output FILE  binary states, required\n"
+              << "    --ticks N      number of ticks per variant (1000)\n"
+              << "    --tick MS      simulated time per tick in ms (1)\n"
+              << "    --threads N    variants simulated at once (hardware threads)\n"
+              << "    --every N      write states every N ticks, 0: final only (0)\n"
+              << "    --integrator NAME  euler, verlet, rk4 or events (scene's choice or euler)\n"
+              << "    --contacts NAME    impulse or penalty (impulse)\n"
+              << "    --gravity NAME     exact, barneshut or attractors (barneshut)\n"
+              << std::endl;
+}
+
+Spec parseSpec(const std::string &specFile, int bodies)
+{
+    std::ifstream file(specFile);
+    if (!file)
+    {
+        std::cerr << "[ERROR] Failed to open spec file: " << specFile << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Spec spec;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::stringstream in(line);
+        std::string key;
+        if (!(in >> key) || key[0] == '#') continue;
+
+        if (key == "variants")
+        {
+            in >> spec.variants;
+        }
+        else if (key == "seed")
+        {
+            in >> spec.seed;
+        }
+        else if (key == "velocity" || key == "position" || key == "mass")
+        {
+            Perturbation p{};
+            p.quantity = key == "velocity" ? Perturbation::Velocity :
+                         key == "position" ? Perturbation::Position : Perturbation::Mass;
+            std::string body, distribution;
+            in >> body >> distribution >> p.range.x;
+            if (p.quantity != Perturbation::Mass) in >> p.range.y >> p.range.z;
+            p.body = body == "*" ? -1 : std::atoi(body.c_str());
+            p.linear = distribution == "linear";
+            if (!in || (distribution != "linear" && distribution != "uniform") || p.body >= bodies ||
+                (body != "*" && p.body < 0))
+            {
+                std::cerr << "[ERROR] Bad perturbation: " << line << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            spec.perturbations.push_back(p);
+        }
+        else
+        {
+            std::cerr << "[ERROR] Unknown spec directive: " << key << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    return spec;
+}
+
+void perturb(Scene::Scene &scene, const Spec &spec, std::uint32_t variant)
+{
+    std::mt19937 random((std::mt19937::result_type)(spec.seed + variant));
+    std::uniform_real_distribution<GLfloat> draw(-1, 1);
+    GLfloat step = spec.variants > 1 ? -1 + 2 * (GLfloat)variant / (GLfloat)(spec.variants - 1) : 0;
+
+    auto &bodies = scene.bodies();
+    for (auto &p : spec.perturbations)
+    {
+        for (std::size_t i=0; i<bodies.size(); i++)
+        {
+            auto &body = bodies[i];
+            if (p.body >= 0 ? (int)i != p.body : !body->state().movable) continue;
+
+            glm::vec3 f = p.linear ? glm::vec3(step) : glm::vec3(draw(random), draw(random), draw(random));
+            switch (p.quantity)
+            {
+                case Perturbation::Velocity: body->accelerate(p.range * f); break;
+                case Perturbation::Position: body->displace(p.range * f); break;
+                case Perturbation::Mass: body->setMass(body->state().mass * (1 + p.range.x * f.x)); break;
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc <= 2)
+    {
+        std::cerr << "Not enough parameter\n";
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    std::string sceneFile{argv[1]};
+    std::string specFile{argv[2]};
+    unsigned long ticks{1000};
+    unsigned int tick{1};
+    unsigned int every{0};
+    std::string outputFile;
+    std::string integrator;
+    Engine::PhysicsModule::Context context;
+    unsigned int cores = std::thread::hardware_concurrency();
+    unsigned int threads = cores > 0 ? cores : 1;
+
+    for (int i=3; i<argc; i++)
+    {
+        std::string option{argv[i]};
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value of " << option << "\n";
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        std::string value{argv[++i]};
+
+        if (option == "--ticks") ticks = std::stoul(value);
+        else if (option == "--tick") tick = (unsigned int)std::stoul(value);
+        else if (option == "--threads") threads = std::max(1u, (unsigned int)std::stoul(value));
+        else if (option == "--every") every = (unsigned int)std::stoul(value);
+        else if (option == "--output") outputFile = value;
+        else if (option == "--integrator") integrator = value;
+        else if (option == "--contacts" && value == "impulse") context.contactModel = Engine::PhysicsModule::ContactModel::Impulse;
+        else if (option == "--contacts" && value == "penalty") context.contactModel = Engine::PhysicsModule::ContactModel::Penalty;
+        else if (option == "--gravity" && value == "exact") context.gravity = Engine::PhysicsModule::Gravity::Exact;
+        else if (option == "--gravity" && value == "barneshut") context.gravity = Engine::PhysicsModule::Gravity::BarnesHut;
+        else if (option == "--gravity" && value == "attractors") context.gravity = Engine::PhysicsModule::Gravity::Attractors;
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n";
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (outputFile.empty())
+    {
+        std::cerr << "Missing --output\n";
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    Engine::PhysicsModule::Integrator choice{};
+    if (!integrator.empty() && !Engine::PhysicsModule::parseIntegrator(integrator, choice))
+    {
+        std::cerr << "Unknown integrator: " << integrator << "\n";
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // one module per thread already keeps every core busy
+    context.threadNum = 0;
+
+    Scene::Scene base(sceneFile);
+    std::uint32_t n = (std::uint32_t)base.bodies().size();
+    Spec spec = parseSpec(specFile, (int)n);
+
+    std::ofstream file(outputFile, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "[ERROR] Failed to open output file: " << outputFile << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::uint32_t variants = spec.variants;
+    float tickSeconds = (float)tick / 1000.0f;
+    file.write("ENS1", 4);
+    file.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    file.write(reinterpret_cast<const char*>(&variants), sizeof(variants));
+    file.write(reinterpret_cast<const char*>(&tickSeconds), sizeof(tickSeconds));
+
+    // records are built by their thread and only the write is serialized
+    std::mutex fileMutex;
+    auto writeRecord = [&](const RecordHeader &header, const std::vector<float> &values)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+    };
+
+    std::atomic<std::uint32_t> next{0};
+    auto run = [&]()
+    {
+        std::vector<float> values;
+        auto writeStates = [&](std::uint32_t variant, unsigned long done, Scene::Scene &scene)
+        {
+            values.clear();
+            for (auto &body : scene.bodies())
+            {
+                auto &state = body->state();
+                values.insert(values.end(), {state.centroid.x, state.centroid.y, state.centroid.z,
+                                             state.velocity.x, state.velocity.y, state.velocity.z});
+            }
+            writeRecord(RecordHeader{variant, (std::uint32_t)done, 1}, values);
+        };
+
+        while (true)
+        {
+            std::uint32_t variant = next++;
+            if (variant >= spec.variants) break;
+
+            auto scene = std::make_shared<Scene::Scene>(base);
+            perturb(*scene, spec, variant);
+            auto physics = std::make_shared<Engine::PhysicsModule>(tick, context);
+            physics->init();
+            physics->setScene(scene);
+            if (!integrator.empty()) physics->setIntegrator(choice);
+
+            values.clear();
+            for (auto &body : scene->bodies())
+            {
+                values.push_back(body->state().mass);
+            }
+            writeRecord(RecordHeader{variant, 0, 0}, values);
+            writeStates(variant, 0, *scene);
+
+            for (unsigned long done=0; done<ticks; )
+            {
+                unsigned long batch = every > 0 ? std::min<unsigned long>(every, ticks - done) : ticks;
+                physics->advance((unsigned int)batch);
+                done += batch;
+                if (every > 0 || done == ticks) writeStates(variant, done, *scene);
+            }
+            physics->finish();
+        }
+    };
+
+    auto t1 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned int i=0; i<std::min(threads, spec.variants); i++)
+    {
+        pool.emplace_back(run);
+    }
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    file.close();
+    if (!file)
+    {
+        std::cerr << "[ERROR] Failed to write output file: " << outputFile << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::chrono::duration<double> elapsed = t2 - t1;
+    double steps = (double)spec.variants * (double)ticks;
+    std::cerr << spec.variants << " variants of " << n << " bodies, " << ticks << " ticks each, on "
+              << pool.size() << " threads in " << elapsed.count() * 1000 << " ms\n"
+              << steps / elapsed.count() << " scene-steps/s, "
+              << steps * n / elapsed.count() << " body-steps/s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "engine/physics.hpp"
+#include "scene/scene.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+// physics only run of a scene, no window and no GL context needed
+
+void usage(const char *program)
+{
+    std::cerr << "Expect: " << program << " [scene file] [options], no scene file with --restore\n"
+              << "    --ticks N      number of ticks to simulate (1000)\n"
+              << "    --tick MS      simulated time per tick in ms (1)\n"
+              << "    --threads N    physics worker threads, 0: run on the main thread (hardware threads)\n"
+              << "    --every N      write states every N ticks, 0: final only (0)\n"
+              << "    --output FILE  write states to FILE instead of stdout\n"
+              << "    --integrator NAME  euler, verlet, rk4 or events (scene's choice or euler),\n"
+              << "                       ignored with --restore\n"
+              << "    --contacts NAME    impulse or penalty (impulse)\n"
+              << "    --iterations N     impulse solver passes per tick (8)\n"
+              << "    --broadphase NAME  grid, tree or brute (grid)\n"
+              << "    --skin M           neighbour list skin in m, 0: pairs found every tick (0)\n"
+              << "    --gravity NAME     exact, barneshut or attractors (barneshut)\n"
+              << "    --sources R        attractors: sources have R times the heaviest mass or more (0.001)\n"
+              << "    --record FILE      body poses of every tick, replayed by the viewer\n"
+              << "    --restore FILE     go on from a checkpoint, ticks count on from its tick\n"
+              << "    --checkpoint FILE  save the state after every --every batch and at the end\n"
+              << "    --profile-csv FILE    per tick phase timings and counters\n"
+              << "    --profile-trace FILE  same as chrome trace_event JSON\n"
+              << std::endl;
+}
+
+void writeStates(std::ostream &out, unsigned long tick, Scene::Scene &scene)
+{
+    for (auto &body : scene.bodies())
+    {
+        auto &state = body->state();
+        out << tick << "," << body->id() << ","
+            << state.centroid.x << "," << state.centroid.y << "," << state.centroid.z << ","
+            << state.velocity.x << "," << state.velocity.y << "," << state.velocity.z << "\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc <= 1)
+    {
+        std::cerr << "Not enough parameter\n";
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // options start right away when the scene comes from a checkpoint
+    int first = std::string(argv[1]).compare(0, 2, "--") == 0 ? 1 : 2;
+    std::string sceneFile{first == 2 ? argv[1] : ""};
+    unsigned long ticks{1000};
+    unsigned int tick{1};
+    unsigned int every{0};
+    std::string outputFile;
+    std::string integrator;
+    std::string restoreFile;
+    std::string checkpointFile;
+    Engine::PhysicsModule::Context context;
+    unsigned int cores = std::thread::hardware_concurrency();
+    context.threadNum = cores > 0 ? cores : 1;
+
+    for (int i=first; i<argc; i++)
+    {
+        std::string option{argv[i]};
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value of " << option << "\n";
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        std::string value{argv[++i]};
+
+        if (option == "--ticks") ticks = std::stoul(value);
+        else if (option == "--tick") tick = (unsigned int)std::stoul(value);
+        else if (option == "--threads") context.threadNum = (unsigned int)std::stoul(value);
+        else if (option == "--every") every = (unsigned int)std::stoul(value);
+        else if (option == "--output") outputFile = value;
+        else if (option == "--integrator") integrator = value;
+        else if (option == "--contacts" && value == "impulse") context.contactModel = Engine::PhysicsModule::ContactModel::Impulse;
+        else if (option == "--contacts" && value == "penalty") context.contactModel = Engine::PhysicsModule::ContactModel::Penalty;
+        else if (option == "--broadphase" && value == "grid") context.broadPhase = Engine::PhysicsModule::BroadPhase::SpatialHash;
+        else if (option == "--broadphase" && value == "tree") context.broadPhase = Engine::PhysicsModule::BroadPhase::AabbTree;
+        else if (option == "--broadphase" && value == "brute") context.broadPhase = Engine::PhysicsModule::BroadPhase::BruteForce;
+        else if (option == "--skin") context.neighborSkin = std::stof(value);
+        else if (option == "--gravity" && value == "exact") context.gravity = Engine::PhysicsModule::Gravity::Exact;
+        else if (option == "--gravity" && value == "barneshut") context.gravity = Engine::PhysicsModule::Gravity::BarnesHut;
+        else if (option == "--gravity" && value == "attractors") context.gravity = Engine::PhysicsModule::Gravity::Attractors;
+        else if (option == "--sources") context.sourceRatio = std::stof(value);
+        else if (option == "--iterations") context.solverIterations = (unsigned int)std::stoul(value);
+        else if (option == "--record") context.recordFile = value;
+        else if (option == "--restore") restoreFile = value;
+        else if (option == "--checkpoint") checkpointFile = value;
+        else if (option == "--profile-csv") context.profileCsv = value;
+        else if (option == "--profile-trace") context.profileTrace = value;
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n";
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (sceneFile.empty() == restoreFile.empty())
+    {
+        std::cerr << "Expect either a scene file or --restore\n";
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+#if !defined(PHYSICS_PROFILE)
+    if (!context.profileCsv.empty() || !context.profileTrace.empty())
+    {
+        std::cerr << "[WARNING] Built without PHYSICS_PROFILE, no profile is written" << std::endl;
+    }
+#endif
+
+    std::ofstream file;
+    if (!outputFile.empty())
+    {
+        file.open(outputFile);
+        if (!file)
+        {
+            std::cerr << "[ERROR] Failed to open output file: " << outputFile << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    std::ostream &out = outputFile.empty() ? std::cout : file;
+
+    auto physics = std::make_shared<Engine::PhysicsModule>(tick, context);
+    physics->init();
+    if (!restoreFile.empty())
+    {
+        if (!physics->restoreCheckpoint(restoreFile)) exit(EXIT_FAILURE);
+    }
+    else
+    {
+        physics->setScene(std::make_shared<Scene::Scene>(sceneFile));
+    }
+    auto scene = physics->scene();
+    if (!integrator.empty() && restoreFile.empty())
+    {
+        Engine::PhysicsModule::Integrator choice;
+        if (!Engine::PhysicsModule::parseIntegrator(integrator, choice))
+        {
+            std::cerr << "Unknown integrator: " << integrator << "\n";
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        physics->setIntegrator(choice);
+    }
+
+    out << "tick,id,x,y,z,vx,vy,vz\n";
+    unsigned long start = physics->ticks();
+    auto t1 = std::chrono::steady_clock::now();
+    for (unsigned long done=0; done<ticks; )
+    {
+        unsigned long batch = every > 0 ? std::min<unsigned long>(every, ticks - done) : ticks;
+        physics->advance((unsigned int)batch);
+        done += batch;
+        if (every > 0 || done == ticks) writeStates(out, start + done, *scene);
+        if (!checkpointFile.empty() && (every > 0 || done == ticks) &&
+            !physics->saveCheckpoint(checkpointFile))
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double, std::milli> elapsed = t2 - t1;
+    std::cerr << ticks << " ticks of " << scene->bodies().size() << " bodies in "
+              << elapsed.count() << " ms ("
+              << (double)ticks / (elapsed.count() / 1000.0) << " ticks/s)" << std::endl;
+    auto stats = physics->stats();
+    std::cerr << stats.awake << " bodies awake in " << stats.islands << " islands, "
+              << stats.sleeping << " asleep" << std::endl;
+
+    physics->finish(); // writes the profile files
+    return 0;
+}
@@ -6,25 +6,18 @@
 #include <stdexcept>
 #include <string>
 
-// int main(int argc, char *argv[])
-int main()
+// [scene file] [trajectory file]: with a trajectory (SampleCodeHeadless
+// --record) its frames are drawn instead of simulating the scene
+int main(int argc, char *argv[])
 {
-    // if (argc <= 1)
-    // {
-    //     std::cerr << "Not enough parameter\n";
-    //     std::cerr << "Expect: " << argv[0]
-    //               << "[scene file]"
-    //               << std::endl;
-    //     exit(EXIT_FAILURE);
-    // }
+    std::string sceneFile{argc > 1 ? argv[1] : "resources/scene_3.txt"};
 
-    // std::string sceneFile{argv[1]};
-
-    // std::cout << "Scene File: " << sceneFile << "\n"
-    //           << std::endl;
+    std::cout << "Scene File: " << sceneFile << "\n"
+              << std::endl;
 
     Engine::Engine engine;
-    engine.loadScene("resources/scene_3.txt");
+    if (argc > 2) engine.loadReplay(sceneFile, argv[2]);
+    else engine.loadScene(sceneFile);
     engine.start();
     
     return 0;
@@ -53,6 +53,11 @@ bool Window::updateFrame()
     }
 }
 
+bool Window::keyPressed(int key) const
+{
+    return glfwGetKey(glwindow_, key) == GLFW_PRESS;
+}
+
 float Window::aspectRatio() const noexcept
 {
     return static_cast<float>(width()) / static_cast<float>(height());
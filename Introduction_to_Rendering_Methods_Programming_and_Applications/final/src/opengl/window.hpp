@@ -18,6 +18,7 @@ public:
                           std::string &windowTitle);
     Window(std::array<int, 2> &windowSize, std::string &windowTitle);
     bool updateFrame();
+    bool keyPressed(int key) const; // GLFW_KEY_*
     float aspectRatio() const noexcept;
     int width() const;
     int height() const;
@@ -0,0 +1,87 @@
+#include "scene/body.hpp"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace Scene
+{
+
+Body::Body(PhysicalState state)
+    : id_{-1}, index_{-1}, mModel_{mat4I}, state_{}
+{
+    // initialize state
+    state_.type = state.type;
+    state_.mass = state.mass;
+    scale(state.radius);
+    displace(state.centroid);
+    accelerate(state.velocity);
+    state_.movable = state.movable;
+}
+
+glm::mat4 Body::model() const
+{
+    return mModel_;
+}
+
+void Body::displace(glm::vec3 diff)
+{
+    state_.centroid += diff;
+
+    glm::mat4 T = glm::translate(mat4I, diff);
+    mModel_ = T * mModel_;
+}
+
+void Body::displace(float dx, float dy, float dz)
+{
+    auto diff = glm::vec3(dx, dy, dz);
+    displace(diff);
+}
+
+void Body::accelerate(glm::vec3 diff)
+{
+    state_.velocity += diff;
+}
+
+void Body::accelerate(float dx, float dy, float dz)
+{
+    auto diff = glm::vec3(dx, dy, dz);
+    accelerate(diff);
+}
+
+void Body::scale(glm::vec3 diff)
+{
+    state_.radius *= diff;
+    for (int i=0; i<3; i++)
+    {
+        state_.normals[i] *= diff;
+    }
+
+    glm::mat4 T = glm::scale(mat4I, diff);
+    mModel_ = T * mModel_;
+}
+
+void Body::scale(float dx, float dy, float dz)
+{
+    auto diff = glm::vec3(dx, dy, dz);
+    scale(diff);
+}
+
+void Body::setMass(GLfloat mass)
+{
+    state_.mass = mass;
+}
+
+const Body::PhysicalState& Body::state()
+{
+    return state_;
+}
+
+int Body::id() { return id_; }
+
+void Body::setId(int id) { id_ = id; }
+
+int Body::index() const { return index_; }
+
+void Body::setIndex(int index) { index_ = index; }
+
+} // namespace Scene
@@ -0,0 +1,65 @@
+#ifndef SCENE_BODY_HPP
+#define SCENE_BODY_HPP
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include <array>
+
+const glm::mat4 mat4I{1};
+const glm::vec3 vec3Z{0};
+const glm::vec3 vec3I{1};
+
+namespace Scene
+{
+
+// physical description of an object, no render resources involved so it
+// can be simulated without a GL context
+class Body
+{
+public:
+    enum Type
+    {
+        None,
+        Sphere,
+        Cube
+    };
+
+    struct PhysicalState
+    {
+        Type type = Type::None;
+        GLfloat mass = 0;
+        glm::vec3 radius = vec3I; // for cube, radius is (side length / 2)
+        std::array<glm::vec3, 3> normals = {glm::vec3{1,0,0}, glm::vec3{0,1,0}, glm::vec3{0,0,1}};
+        glm::vec3 centroid = vec3Z;
+        glm::vec3 velocity = vec3Z;
+        bool movable = true;
+    };
+
+    explicit Body(PhysicalState state);
+    int id();
+    void setId(int id);
+    int index() const;
+    void setIndex(int index); // index in the physics body store
+
+    glm::mat4 model() const;
+    const PhysicalState& state();
+
+    void displace(glm::vec3 diff);
+    void displace(float dx, float dy, float dz);
+    void accelerate(glm::vec3 diff);
+    void accelerate(float dx, float dy, float dz);
+    void scale(glm::vec3 diff);
+    void scale(float dx, float dy, float dz);
+    void setMass(GLfloat mass); // before the scene is handed to physics
+private:
+    int id_;
+    int index_;
+    glm::mat4 mModel_;
+
+    PhysicalState state_;
+};
+
+}
+
+#endif // SCENE_BODY_HPP
@@ -20,13 +20,41 @@ Scene::Scene(std::string sceneFile)
     int counter = 0;
     while (std::getline(file, line)) {
         if (line[0] == '#') { continue; }
-        auto obj = createObject(line);
-        obj->setId(counter++);
-        objects_.push_back(obj);
+        if (parseDirective(line)) { continue; }
+        auto body = createBody(line);
+        body->setId(counter++);
+        bodies_.push_back(body);
     }
 }
 
-std::shared_ptr<Object> Scene::createObject(std::string info)
+Scene::Scene(const Context &context)
+    : context_{context}
+{}
+
+Scene::Scene(const Scene &scene)
+    : appearances_{scene.appearances_}, context_{scene.context_}
+{
+    for (auto &body : scene.bodies_)
+    {
+        bodies_.push_back(std::make_shared<Body>(*body));
+    }
+}
+
+bool Scene::parseDirective(std::string info)
+{
+    std::stringstream infoIn(info);
+    std::string key;
+    infoIn >> key;
+
+    if (key == "integrator")
+    {
+        infoIn >> context_.integrator;
+        return true;
+    }
+    return false;
+}
+
+std::shared_ptr<Body> Scene::createBody(std::string info)
 {
     std::stringstream infoIn(info);
     std::string type;
@@ -49,7 +77,7 @@ std::shared_ptr<Object> Scene::createObject(std::string info)
     return nullptr;
 }
 
-std::shared_ptr<Object> Scene::createSphere(std::string info)
+std::shared_ptr<Body> Scene::createSphere(std::string info)
 {
     std::stringstream infoIn(info);
 
@@ -67,7 +95,7 @@ std::shared_ptr<Object> Scene::createSphere(std::string info)
            >> movable
            >> texture_file;
 
-    Object::PhysicalState state{Object::Type::Sphere,
+    Body::PhysicalState state{Body::Type::Sphere,
                                 mass,
                                 glm::vec3(radius),
                                 {glm::vec3(0), glm::vec3(0), glm::vec3(0)}, 
@@ -75,25 +103,25 @@ std::shared_ptr<Object> Scene::createSphere(std::string info)
                                 velocity,
                                 movable};
 
-    std::shared_ptr<Object> obj(new Object("resources/model/sphere.obj",
-                                           texture_file.c_str(),
-                                           state));
+    std::shared_ptr<Body> obj(new Body(state));
+    appearances_.push_back(Appearance{"resources/model/sphere.obj", texture_file});
     
-    std::cout << "type: " << (int)obj->state().type << std::endl;
-    std::cout << "mass: " << obj->state().mass << std::endl;
-    std::cout << "radius: " << glm::to_string(obj->state().radius) << std::endl;
+    // on the log stream, stdout is left to what the programs write out
+    std::clog << "type: " << (int)obj->state().type << std::endl;
+    std::clog << "mass: " << obj->state().mass << std::endl;
+    std::clog << "radius: " << glm::to_string(obj->state().radius) << std::endl;
     for (int i = 0; i <3; i++)
-        std::cout << "normal: " << glm::to_string(obj->state().normals[i]) << std::endl;
-    std::cout << "centroid: " << glm::to_string(obj->state().centroid) << std::endl;
-    std::cout << "velocity: " << glm::to_string(obj->state().velocity) << std::endl;
-    std::cout << "movable: " << obj->state().movable << std::endl;
-    // std::cout << "model: " << glm::to_string(obj->model()) << std::endl;
-    std::cout << "texture: " << texture_file << std::endl;
+        std::clog << "normal: " << glm::to_string(obj->state().normals[i]) << std::endl;
+    std::clog << "centroid: " << glm::to_string(obj->state().centroid) << std::endl;
+    std::clog << "velocity: " << glm::to_string(obj->state().velocity) << std::endl;
+    std::clog << "movable: " << obj->state().movable << std::endl;
+    // std::clog << "model: " << glm::to_string(obj->model()) << std::endl;
+    std::clog << "texture: " << texture_file << std::endl;
 
     return obj;
 }
 
-std::shared_ptr<Object> Scene::createCube(std::string info)
+std::shared_ptr<Body> Scene::createCube(std::string info)
 {
     std::stringstream infoIn(info);
 
@@ -113,7 +141,7 @@ std::shared_ptr<Object> Scene::createCube(std::string info)
            >> movable
            >> texture_file;
 
-    Object::PhysicalState state{Object::Type::Cube,
+    Body::PhysicalState state{Body::Type::Cube,
                                 mass,
                                 radius,
                                 {glm::vec3(0), glm::vec3(0), glm::vec3(0)}, 
@@ -121,26 +149,35 @@ std::shared_ptr<Object> Scene::createCube(std::string info)
                                 velocity,
                                 movable};
 
-    std::shared_ptr<Object> obj(new Object("resources/model/cube.obj",
-                                           texture_file.c_str(),
-                                           state));
+    std::shared_ptr<Body> obj(new Body(state));
+    appearances_.push_back(Appearance{"resources/model/cube.obj", texture_file});
     
-    std::cout << "type: " << (int)obj->state().type << std::endl;
-    std::cout << "mass: " << obj->state().mass << std::endl;
-    std::cout << "radius: " << glm::to_string(obj->state().radius) << std::endl;
+    std::clog << "type: " << (int)obj->state().type << std::endl;
+    std::clog << "mass: " << obj->state().mass << std::endl;
+    std::clog << "radius: " << glm::to_string(obj->state().radius) << std::endl;
     for (int i = 0; i <3; i++) 
-        std::cout << "normal: " << glm::to_string(obj->state().normals[i]) << std::endl;
-    std::cout << "centroid: " << glm::to_string(obj->state().centroid) << std::endl;
-    std::cout << "velocity: " << glm::to_string(obj->state().velocity) << std::endl;
-    std::cout << "movable: " << obj->state().movable << std::endl;
-    // std::cout << "model: " << glm::to_string(obj->model()) << std::endl;
-    std::cout << "texture: " << texture_file << std::endl;
+        std::clog << "normal: " << glm::to_string(obj->state().normals[i]) << std::endl;
+    std::clog << "centroid: " << glm::to_string(obj->state().centroid) << std::endl;
+    std::clog << "velocity: " << glm::to_string(obj->state().velocity) << std::endl;
+    std::clog << "movable: " << obj->state().movable << std::endl;
+    // std::clog << "model: " << glm::to_string(obj->model()) << std::endl;
+    std::clog << "texture: " << texture_file << std::endl;
 
     return obj;
 }
 
-std::vector<std::shared_ptr<Object>>& Scene::objects() { return objects_; }
+std::vector<std::shared_ptr<Body>>& Scene::bodies() { return bodies_; }
+
+const std::vector<Scene::Appearance>& Scene::appearances() { return appearances_; }
 
 const Scene::Context& Scene::context() { return context_; }
 
+void Scene::addBody(const Body::PhysicalState &state, const Appearance &appearance)
+{
+    auto body = std::make_shared<Body>(state);
+    body->setId((int)bodies_.size());
+    bodies_.push_back(body);
+    appearances_.push_back(appearance);
+}
+
 }
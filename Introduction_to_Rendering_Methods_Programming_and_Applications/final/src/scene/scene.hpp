@@ -2,7 +2,7 @@
 #define SCENE_SCENE_HPP
 
 #include "scene/environment.hpp"
-#include "scene/object.hpp"
+#include "scene/body.hpp"
 #include "scene/camera.hpp"
 #include "glm/glm.hpp"
 
@@ -21,17 +21,32 @@ public:
     {
         GLfloat G = (GLfloat)(6.67408 * std::pow(10,-11));
         GLfloat g = (GLfloat)(9.8);
+        std::string integrator; // "integrator <name>" line, empty: engine default
+    };
+
+    // what a renderer needs to draw a body, never loaded by the scene itself
+    struct Appearance
+    {
+        std::string model;
+        std::string texture;
     };
 
     explicit Scene(std::string sceneFile);
-    std::vector<std::shared_ptr<Object>>& objects();
+    explicit Scene(const Context &context); // empty, filled by addBody()
+    Scene(const Scene &scene); // bodies are copied, not shared
+    Scene& operator=(const Scene &scene) = delete;
+    std::vector<std::shared_ptr<Body>>& bodies();
+    const std::vector<Appearance>& appearances(); // appearances()[i] is of bodies()[i]
     const Context& context();
+    void addBody(const Body::PhysicalState &state, const Appearance &appearance);
 private:
-    std::shared_ptr<Object> createObject(std::string info);
-    std::shared_ptr<Object> createSphere(std::string info);
-    std::shared_ptr<Object> createCube(std::string info);
+    bool parseDirective(std::string info);
+    std::shared_ptr<Body> createBody(std::string info);
+    std::shared_ptr<Body> createSphere(std::string info);
+    std::shared_ptr<Body> createCube(std::string info);
     
-    std::vector<std::shared_ptr<Object>> objects_;
+    std::vector<std::shared_ptr<Body>> bodies_;
+    std::vector<Appearance> appearances_;
     Context context_;
 };
 